@@ -13,6 +13,8 @@ enum class CommandType
     COPY,       // 复制文件
     WRITE,      // 写入文件
     TOUCH,      // 创建空文件
+    MKDIR,      // 创建目录
+    RMDIR,      // 删除空目录
     EXIT,       // 退出程序
     EMPTY,      // 空输入（仅回车）
     UNKNOWN     // 未知命令
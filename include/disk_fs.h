@@ -3,38 +3,390 @@
 
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
 #include <fstream>
 #include <vector>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
 
 // 常量定义
 const int BLOCK_SIZE = 4096;               // 磁盘块大小（4KB，常见的块大小选择）
-const int INODE_SIZE = 96;                // 每个inode的大小（字节）
-const int MAX_FILENAME = 28;               // 最大文件名长度（含终止符，共28字节）
-const int MAX_INODES = 1024;               // 最大inode数量（支持最多1024个文件/目录）
+const int INODE_SIZE = 128;               // 每个inode的磁盘大小（字节，定长，inode不会跨越缓存行或块边界）
+const int INODES_PER_BLOCK = BLOCK_SIZE / INODE_SIZE;  // 每个inode表块容纳的inode数（32个）
+const int MAX_FILENAME = 256;              // 最大文件名长度（含终止符，文件名最长255字节）
+const int MAX_INODES = 1024;               // 固定inode区的inode数量（格式化时分配，超出后按块组动态扩展）
 const int MAX_BLOCKS = (1024 * 1024 * 100) / BLOCK_SIZE;  // 总块数（100MB磁盘）
+const int DIRECT_BLOCKS = 16;              // inode中的直接块指针数
+const int PTRS_PER_BLOCK = BLOCK_SIZE / sizeof(uint32_t);  // 每个间接块容纳的块指针数（1024个）
+const int META_CACHE_BLOCKS = 256;         // 元数据块（间接块等）缓存容量（块数，共1MB）
+const int DENTRY_CACHE_SIZE = 4096;        // 目录项缓存容量（条目数，含“不存在”的否定条目）
+const int INODE_LOCK_STRIPES = 64;         // inode锁的分片数（按inode编号取模，不同文件的读写可并行）
+const int TAIL_FRAGMENT_SIZE = 256;        // 共享尾部块的分配粒度（字节，每块16个片段）
+const int TAIL_PACK_MAX = BLOCK_SIZE / 2;  // 不超过该长度的文件尾部打包进共享块
+const int TAIL_SLOTS_PER_BLOCK = BLOCK_SIZE / TAIL_FRAGMENT_SIZE;  // 每个共享块的片段数（16个）
+const int DIR_INDEX_GROUP = 16;            // 目录哈希索引的分组宽度（一次比较的标签数，对应一个128位向量）
+const int DIR_BLOOM_BITS = 10;             // B+树目录布隆过滤器每个目录项的位数（7个哈希函数，误判率约1%）
+const int DIR_BLOOM_MIN = 1024;            // 布隆过滤器按容纳的最少目录项数建立
+
+// inode特性标志位（Inode::flags）
+const uint8_t INODE_FLAG_EXTENTS = 0x01;   // 文件使用extent树映射数据块（blocks区域存放extent树根）
+const uint8_t INODE_FLAG_INLINE = 0x02;    // 文件数据内联存放在inode中（blocks起至inode末尾）
+const uint8_t INODE_FLAG_TAIL = 0x04;      // 文件末尾不足一块的部分存放在共享尾部块中
+const uint8_t INODE_FLAG_DIR_BTREE = 0x08; // 目录以B+树组织（blocks[0]为树根块号）
+const uint8_t INODE_FLAG_DIR_VARLEN = 0x10; // 目录项为变长记录（无此标志的旧目录为定长目录项，首次访问时转换）
+
+// 按路径写入的打开标志（DiskFS::write_path的flags参数）
+const int OPEN_CREATE = 0x01;              // 文件不存在时创建
+const int OPEN_EXCL = 0x02;                // 与OPEN_CREATE同用：文件已存在时失败
+
+const char FS_MAGIC[] = "SIMFSv2";         // 当前文件系统标识（定长inode格式）
+const char FS_MAGIC_V1[] = "SIMFSv1";      // 旧版文件系统标识（挂载时自动升级）
 
 /**
- * @brief inode结构：存储文件/目录的元数据
+ * @brief inode结构：存储文件/目录的元数据（SIMFSv2磁盘格式）
+ * 所有字段均为定宽类型且按自然对齐排列，结构体大小固定为INODE_SIZE（128字节），
+ * 与平台的time_t宽度和填充规则无关；inode表块可直接作为Inode数组整体读写
  */
 struct Inode 
 {
     uint32_t inode_num;      // inode编号（唯一标识）
     uint32_t size;           // 文件大小（字节）
-    uint32_t blocks[16];     // 数据块指针数组（直接块，最多16个块）
+    int64_t create_time;     // 创建时间（64位时间戳）
+    int64_t modify_time;     // 最后修改时间（64位时间戳）
     uint8_t type;            // 类型：1表示文件，2表示目录
     uint8_t used;            // 使用状态：1表示已使用，0表示未使用
-    time_t create_time;      // 创建时间（时间戳）
-    time_t modify_time;      // 最后修改时间（时间戳）
+    uint8_t flags;           // 特性标志位（INODE_FLAG_*）
+    uint8_t reserved0;       // 预留字段
+    uint32_t tail_block;     // 共享尾部块的块号（INODE_FLAG_TAIL时有效）
+    uint16_t tail_offset;    // 尾部数据在共享块内的字节偏移（TAIL_FRAGMENT_SIZE对齐）
+    uint8_t reserved[6];     // 预留字段（填充至40字节头部）
+    uint32_t blocks[DIRECT_BLOCKS];  // 数据块指针数组（直接块，覆盖前16个块）
+    uint32_t indirect;       // 一级间接块（存放PTRS_PER_BLOCK个数据块指针）
+    uint32_t double_indirect; // 二级间接块（存放PTRS_PER_BLOCK个一级间接块指针）
+    uint8_t spare[16];       // 预留字段（填充至INODE_SIZE）
+};
+static_assert(sizeof(Inode) == INODE_SIZE, "Inode磁盘格式必须为INODE_SIZE字节");
+static_assert(BLOCK_SIZE % INODE_SIZE == 0, "inode不能跨越块边界");
+
+const int INLINE_DATA_SIZE = INODE_SIZE - offsetof(Inode, blocks);  // 内联数据容量（88字节）
+
+// 动态inode表块组：固定inode区用尽后，从数据区划出连续块作为新的inode表
+// 每个块组 = 1个inode位图块 + INODE_CHUNK_TABLE_BLOCKS个inode表块
+const int INODE_CHUNK_INODES = 1024;       // 每个块组容纳的inode数
+const int INODE_CHUNK_TABLE_BLOCKS = INODE_CHUNK_INODES / INODES_PER_BLOCK;  // 每个块组的inode表块数（32个）
+const int INODE_CHUNK_BLOCKS = 1 + INODE_CHUNK_TABLE_BLOCKS;  // 每个块组占用的块数（33个）
+const int MAX_INODE_CHUNKS = 256;          // 块组数上限（inode总数最多1024 + 256×1024个）
+
+/**
+ * @brief extent树节点头：位于inode的blocks区域（树根）或extent树块的开头
+ */
+struct ExtentHeader
+{
+    uint16_t entries;        // 节点中的有效记录数
+    uint16_t depth;          // 节点高度：0表示叶子（记录为Extent），>0表示索引节点
+};
+
+/**
+ * @brief extent记录：叶子节点中表示一段连续映射，索引节点中表示一个子节点
+ * 叶子：逻辑块[logical, logical+length)映射到磁盘块[physical, physical+length)
+ * 索引：logical为子树中最小的逻辑块号，physical为子节点所在的块号，length不使用
+ */
+struct Extent
+{
+    uint32_t logical;        // 起始逻辑块号
+    uint32_t physical;       // 起始磁盘块号（索引节点中为子节点块号）
+    uint32_t length;         // 连续块数
+};
+
+const int EXTENT_ROOT_MAX = (sizeof(Inode::blocks) - sizeof(ExtentHeader)) / sizeof(Extent);  // inode内树根容量（5条）
+const int EXTENT_NODE_MAX = (BLOCK_SIZE - sizeof(ExtentHeader)) / sizeof(Extent);  // extent树块容量（341条）
+
+/**
+ * @brief 挂载选项
+ */
+struct MountOptions
+{
+    bool extents;            // 新建文件使用extent树映射（默认使用直接/间接块指针）
+    bool preload;            // 挂载时将整个inode表和所有位图读入内存
+    bool lazytime;           // 仅修改时间变化的inode更新暂存内存，随其它inode修改或sync/卸载时写回
+
+    MountOptions() : extents(false), preload(false), lazytime(false) {}
 };
 
 /**
- * @brief 目录项结构：存储文件名与inode的映射
+ * @brief 目录项结构：存储文件名与inode的映射（目录遍历接口返回的格式，不是磁盘格式）
  */
 struct DirEntry
 {
-    char name[MAX_FILENAME]; // 文件名（最大28字节，含'\0'）
+    char name[MAX_FILENAME]; // 文件名（以'\0'结尾）
     uint32_t inode_num;      // 对应的inode编号
     uint8_t valid;           // 有效性：1表示有效，0表示已删除
+    uint8_t type;            // 文件类型：2表示目录，其余（含旧镜像中的0）表示普通文件
+};
+
+/**
+ * @brief 线性目录块中的变长目录记录（记录头之后紧跟name_len字节的文件名，无终止符）
+ * 块内的记录首尾相接覆盖整个块，rec_len为记录占用的长度（4字节对齐，含其后未使用的空间）；
+ * 删除的记录并入前一条记录，因此只有块首的记录可能是空闲记录（name_len为0）
+ */
+struct DirRecord
+{
+    uint32_t inode_num;      // 对应的inode编号
+    uint16_t rec_len;        // 记录占用的长度（到下一条记录的偏移）
+    uint8_t name_len;        // 文件名长度（0表示空闲记录）
+    uint8_t type;            // 文件类型（同DirEntry::type）
+};
+
+static_assert(sizeof(DirRecord) == 8, "目录记录头必须为8字节");
+const int DIR_BTREE_MIN_BLOCKS = 8;  // 线性目录已占满该块数后转换为B+树目录（短文件名时约2000个目录项）
+
+/**
+ * @brief B+树目录节点头（位于每个树块开头，其后为按文件名排序的记录偏移数组）
+ * 节点为分槽页：记录从块尾向前存放，偏移数组从头部之后向后增长，删除记录留下的空洞在空间不足时整理
+ */
+struct DirTreeHeader
+{
+    uint16_t entries;        // 节点中的有效记录数
+    uint16_t depth;          // 节点高度：0表示叶子，叶子记录为目录项，否则为索引记录
+    uint32_t next;           // 右侧兄弟叶子的块号（仅叶子有效，0表示最后一个叶子）
+    uint16_t heap;           // 记录区的起始偏移（记录区为[heap, BLOCK_SIZE)）
+    uint16_t reserved;       // 预留字段
+};
+
+/**
+ * @brief B+树目录节点记录头（之后紧跟name_len字节的文件名，整条记录4字节对齐）
+ * 叶子中为文件名 -> inode编号；索引节点中为子树文件名下界 -> 子节点块号（首条记录的下界视为无穷小）
+ */
+struct DirTreeRecord
+{
+    uint32_t value;          // inode编号（叶子）或子节点块号（索引节点）
+    uint8_t type;            // 文件类型（仅叶子有效，同DirEntry::type）
+    uint8_t name_len;        // 文件名长度
+    uint16_t reserved;       // 预留字段
+};
+
+static_assert(sizeof(DirTreeHeader) == 12 && sizeof(DirTreeRecord) == 8, "B+树目录节点格式大小不符");
+
+/**
+ * @brief 目录索引项：文件名对应的inode及目录项在磁盘上的位置（仅存在于内存中）
+ */
+struct DirSlot
+{
+    uint32_t inode_num;      // 对应的inode编号
+    uint32_t block;          // 目录项所在的目录块序号（目录文件内的逻辑块号）
+    uint32_t slot;           // 目录记录在块内的字节偏移
+    uint8_t type;            // 文件类型（同DirEntry::type）
+};
+
+/**
+ * @brief 目录哈希索引标签匹配内核：比较一组DIR_INDEX_GROUP个标签
+ * @param group 标签组首地址
+ * @param tag 目标标签
+ * @return 匹配位掩码（第i位为1表示group[i] == tag）
+ * 支持SSE2时一条向量比较完成一组，否则退化为逐个比较（dir_tag_match_scalar）
+ */
+uint32_t dir_tag_match(const uint8_t* group, uint8_t tag);
+uint32_t dir_tag_match_scalar(const uint8_t* group, uint8_t tag);
+
+/**
+ * @brief 取出一组标签中的空闲位置（空槽或已删除槽）
+ * @param group 标签组首地址
+ * @return 空闲位掩码（第i位为1表示group[i]为空槽或已删除槽）
+ */
+uint32_t dir_tag_free(const uint8_t* group);
+
+/**
+ * @brief 文件名哈希（目录哈希索引与目录项缓存使用）
+ * @param name 文件名首地址（不要求以'\0'结尾）
+ * @param len 文件名长度
+ * @return 64位哈希值（低7位作为索引标签，其余位决定分组）
+ * 直接对字节序列计算，查找路径中的分量时不必先复制为std::string
+ */
+size_t dir_name_hash(const char* name, size_t len);
+
+/**
+ * @brief 线性目录的哈希索引：文件名 -> 目录项位置（开放寻址，仅存在于内存中）
+ * 每个槽位另有1字节标签（哈希值低7位；空槽、已删除槽用最高位为1的特殊值），标签连续存放，
+ * 查找时一次比较一组DIR_INDEX_GROUP个标签，只对标签命中且完整哈希相同的槽位比较文件名，
+ * 空槽与已删除槽整组跳过；组内出现空槽即可判定不存在
+ */
+class DirIndex
+{
+public:
+    DirIndex() : count(0), deleted(0) {}
+
+    DirSlot* find(const char* name, size_t len);
+    DirSlot* find(const std::string& name) { return find(name.data(), name.size()); }
+    void insert(const std::string& name, const DirSlot& slot);  // 已存在时覆盖
+    bool erase(const std::string& name);
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear();
+    void swap(DirIndex& other);
+
+    // 按槽位顺序访问全部目录项：f(文件名, 目录项位置)
+    template <typename F>
+    void for_each(F f) const
+    {
+        for (size_t i = 0; i < tags.size(); i++) {
+            if (tags[i] < 0x80) f(items[i].name, items[i].slot);
+        }
+    }
+
+private:
+    struct Item
+    {
+        std::string name;    // 文件名
+        DirSlot slot;        // 目录项位置
+        size_t hash;         // 文件名的完整哈希值（扩容时免于重新计算）
+    };
+
+    std::vector<uint8_t> tags;  // 各槽位的标签（槽位数为DIR_INDEX_GROUP的2的幂倍）
+    std::vector<Item> items;    // 各槽位的目录项
+    size_t count;               // 有效目录项数
+    size_t deleted;             // 已删除槽数（重建时清除）
+
+    long probe(const char* name, size_t len, size_t hash) const;  // 查找槽位，不存在返回-1
+    void rehash(size_t slots);  // 重建为slots个槽位
+};
+
+/**
+ * @brief B+树目录的布隆过滤器：判定文件名"一定不存在"，使不命中的查找不必访问树块（仅存在于内存中）
+ * 按当时目录项数的两倍容量建立；布隆过滤器不能删除元素，删除的文件名仍留在过滤器中，
+ * 只会使误判变多而不会漏判，加入或删除的文件名超出容量时由调用者按树中现有文件名重建。
+ * 未建立（或建立失败）时视为可能包含任何文件名
+ */
+class DirBloom
+{
+public:
+    DirBloom() : capacity(0), added(0), removed(0) {}
+
+    void build(const std::vector<size_t>& hashes);  // 按文件名哈希值列表重新建立
+    void add(const std::string& name);
+    void remove() { removed++; }
+    bool may_contain(const char* name, size_t len) const;
+    bool stale() const { return !bits.empty() && (added > capacity || removed * 2 > capacity); }  // 需要重建
+    void clear();
+    void swap(DirBloom& other);
+
+private:
+    std::vector<uint64_t> bits;  // 位数组
+    size_t capacity;             // 建立时设计容纳的目录项数
+    size_t added;                // 建立以来加入的文件名数（含建立时的全部文件名）
+    size_t removed;              // 建立以来删除的文件名数
+
+    void set_hash(size_t hash);
+};
+
+/**
+ * @brief 共享尾部块的片段占用表（仅存在于内存中，挂载时按inode表重建）
+ * 除各块的已用片段位图外，按块内最长一段连续空闲片段的长度分组记录尚有空闲的块，
+ * 存放尾部时从能容纳的最短分组中取一个块，不必逐块扫描；片段已用完的块不在任何分组中
+ */
+class TailSlots
+{
+public:
+    bool find(uint32_t count, uint32_t& block, uint32_t& first) const;  // 查找count个连续空闲片段
+    uint16_t used(uint32_t block) const;  // 块的已用片段位图（不是共享块时为0）
+    void set(uint32_t block, uint16_t used);  // 更新块的已用片段位图（为0时移除该块）
+    void clear();
+
+private:
+    std::unordered_map<uint32_t, uint16_t> used_map;  // 共享尾部块 -> 已用片段位图
+    std::unordered_set<uint32_t> by_run[TAIL_SLOTS_PER_BLOCK];  // 按最长连续空闲片段数分组（下标为片段数-1）
+};
+
+/**
+ * @brief 目录块信息：目录块的磁盘位置与可容纳新记录的最大空间（仅存在于内存中）
+ */
+struct DirBlockInfo
+{
+    uint32_t block;          // 目录块的磁盘块号
+    uint16_t max_free;       // 块内最大的一段可用空间（字节，可放入不超过该长度的新记录）
+};
+
+/**
+ * @brief 已加载目录的内存状态（首次访问目录时建立）
+ * 线性目录保存完整的哈希索引与目录块表；B+树目录只记录树根，查找直接访问磁盘上的树
+ */
+struct DirState
+{
+    DirIndex index;                  // 线性目录：文件名 -> 目录项位置
+    std::vector<DirBlockInfo> blocks;  // 线性目录：各目录块（按逻辑块号排列）
+    std::set<uint32_t> free_blocks;  // 线性目录：仍有可用空间的目录块序号（插入时取最小者，使目录项集中在前面的块）
+    std::set<std::string> names;     // 线性目录：按文件名排序的全部文件名（供前缀/范围查询）
+    uint32_t tree_root;      // B+树目录的树根块号（0表示线性目录）
+    DirBloom bloom;          // B+树目录：文件名布隆过滤器（线性目录的哈希索引本身即可判定不存在）
+    uint32_t version;        // 目录版本：加载及每次增删目录项时取全局递增的新值（遍历游标据此判断是否需要重新定位）
+
+    DirState() : tree_root(0), version(0) {}
+};
+
+/**
+ * @brief 目录遍历游标（readdir风格，由open_dir初始化，read_dir逐项推进）
+ * 游标记录位置与上次返回的文件名；遍历期间增删目录项（包括线性目录转换为B+树目录）时，
+ * 按上次返回的文件名重新定位：已返回的项不会重复，已删除的项不再返回，新增的项可能返回也可能不返回
+ */
+struct DirCursor
+{
+    uint32_t dir;            // 目录的inode编号
+    uint32_t block;          // 线性目录：当前目录块序号；B+树目录：当前叶子块号（0表示遍历结束）
+    uint32_t slot;           // 线性目录：下一条记录的块内偏移；B+树目录：下一条叶子记录的下标
+    uint32_t version;        // 游标定位时的目录版本
+    bool tree;               // 游标定位时目录是否为B+树目录
+    char last[MAX_FILENAME]; // 上次返回的文件名（空串表示尚未返回目录项）
+
+    DirCursor() : dir(0), block(0), slot(0), version(0), tree(false) { last[0] = '\0'; }
+};
+
+/**
+ * @brief 目录项缓存条目：(目录inode, 文件名) -> inode编号，inode_num为-1表示文件不存在
+ */
+struct Dentry
+{
+    uint32_t dir;            // 所在目录的inode编号
+    std::string name;        // 文件名
+    int inode_num;           // 对应的inode编号；-1为否定条目
+    uint8_t type;            // 文件类型（同DirEntry::type）
+};
+
+/**
+ * @brief 文件名引用：目录项缓存的键，指向缓存条目中的文件名或调用者的路径分量，不复制文件名
+ */
+struct NameRef
+{
+    const char* data;        // 文件名首地址（不要求以'\0'结尾）
+    size_t len;              // 文件名长度
+
+    NameRef(const char* d, size_t n) : data(d), len(n) {}
+    bool operator==(const NameRef& other) const { return len == other.len && memcmp(data, other.data, len) == 0; }
+};
+
+struct NameRefHash
+{
+    size_t operator()(const NameRef& name) const { return dir_name_hash(name.data, name.len); }
+};
+
+/**
+ * @brief 批量写入中的一项（DiskFS::write_batch：同一目录下的多个文件）
+ */
+struct BatchWrite
+{
+    std::string name;        // 文件名（不含目录部分）
+    const char* data;        // 写入的内容（从偏移0开始写入）
+    size_t size;             // 内容长度（为0时只打开或创建文件）
+    bool touch;              // true：只在文件不存在时创建空文件，不写入内容
+    int inode_num;           // 输出：文件的inode编号；失败为-1
+    bool created;            // 输出：文件是否由本次调用创建
+    int result;              // 输出：写入的字节数（touch为0）；失败为-1
+
+    BatchWrite() : data(nullptr), size(0), touch(false), inode_num(-1), created(false), result(-1) {}
 };
 
 /**
@@ -42,7 +394,7 @@ struct DirEntry
  */
 struct SuperBlock
 {
-    char magic[8];           // 文件系统标识（"SIMFSv1"，用于验证）
+    char magic[8];           // 文件系统标识（"SIMFSv2"，用于验证）
     uint32_t block_size;     // 块大小（字节，应等于BLOCK_SIZE）
     uint32_t total_blocks;   // 磁盘总块数
     uint32_t inode_blocks;   // inode区占用的块数
@@ -54,10 +406,84 @@ struct SuperBlock
     uint32_t inode_bitmap;   // inode位图起始块号（管理inode分配）
     uint32_t inode_start;    // inode区起始块号
     uint32_t data_start;     // 数据区起始块号
+    uint32_t inode_chunk_count;  // 已分配的动态inode表块组数
+    uint32_t inode_chunks[MAX_INODE_CHUNKS];  // 各块组的起始块号（首块为该组的inode位图）
+};
+static_assert(sizeof(SuperBlock) <= BLOCK_SIZE, "超级块必须能放入一个块");
+
+/**
+ * @brief 读写锁：共享持有者之间不互斥，独占持有者与其他所有持有者互斥（C++11没有std::shared_mutex）
+ * 有线程等待独占持有时，新的共享请求也需等待，避免读多写少时写操作一直得不到锁。
+ * 独占持有使用std::lock_guard/std::unique_lock，共享持有使用SharedLock
+ */
+class SharedMutex
+{
+public:
+    SharedMutex() : readers(0), writer(false), waiting_writers(0) {}
+
+    void lock()
+    {
+        std::unique_lock<std::mutex> guard(state_mutex);
+        waiting_writers++;
+        writer_cv.wait(guard, [this] { return !writer && readers == 0; });
+        waiting_writers--;
+        writer = true;
+    }
+
+    void unlock()
+    {
+        std::lock_guard<std::mutex> guard(state_mutex);
+        writer = false;
+        if (waiting_writers > 0) writer_cv.notify_one();
+        else reader_cv.notify_all();
+    }
+
+    void lock_shared()
+    {
+        std::unique_lock<std::mutex> guard(state_mutex);
+        reader_cv.wait(guard, [this] { return !writer && waiting_writers == 0; });
+        readers++;
+    }
+
+    void unlock_shared()
+    {
+        std::lock_guard<std::mutex> guard(state_mutex);
+        if (--readers == 0 && waiting_writers > 0) writer_cv.notify_one();
+    }
+
+private:
+    std::mutex state_mutex;
+    std::condition_variable reader_cv;  // 等待共享持有的线程
+    std::condition_variable writer_cv;  // 等待独占持有的线程
+    uint32_t readers;          // 当前共享持有者数
+    bool writer;               // 是否被独占持有
+    uint32_t waiting_writers;  // 等待独占持有的线程数
+};
+
+/**
+ * @brief 在作用域内共享持有SharedMutex
+ */
+class SharedLock
+{
+public:
+    explicit SharedLock(SharedMutex& m) : mutex(m) { mutex.lock_shared(); }
+    ~SharedLock() { if (owned) mutex.unlock_shared(); }
+    SharedLock(const SharedLock&) = delete;
+    SharedLock& operator=(const SharedLock&) = delete;
+    void unlock() { mutex.unlock_shared(); owned = false; }  // 提前释放（如取得更细粒度的锁之后）
+
+private:
+    SharedMutex& mutex;
+    bool owned = true;
 };
 
 /**
  * @brief 磁盘文件系统类：实现模拟磁盘的各种操作
+ * 挂载后的文件与目录操作可由多个线程同时调用，内部按以下顺序加锁（只允许由前往后获取）：
+ * 目录锁 -> inode锁 -> 目录状态锁 -> 元数据块缓存锁 -> 分配器锁 -> inode表锁 -> 磁盘文件流锁；
+ * 同时持有多个inode锁时按锁的地址由低到高获取；目录项缓存锁只在访问缓存本身时持有，期间不获取其他锁。目录锁与inode锁为读写锁：
+ * 路径查找、目录遍历、读文件与查询大小共享持有，可以同时进行；创建、删除与写文件独占持有。
+ * 不同文件的读写只在访问共享结构的短暂区间内互斥；format/mount/unmount须在没有其他线程访问时调用
  */
 class DiskFS
 {
@@ -71,6 +497,7 @@ private:
     std::string disk_path;   // 磁盘文件路径
     SuperBlock super_block;  // 超级块（内存中的副本）
     bool is_mounted;         // 挂载状态：true表示已挂载
+    MountOptions mount_options;  // 当前挂载选项
 
     // 计算各区域在磁盘中的位置（字节偏移量）
     uint32_t get_super_block_pos() { return 0; }  // 超级块固定在0位置
@@ -83,13 +510,128 @@ private:
     bool set_block_bitmap(uint32_t block_num, bool used);  // 更新块位图
     bool set_inode_bitmap(uint32_t inode_num, bool used);  // 更新inode位图
     int find_free_block();  // 查找空闲数据块
-    int find_free_inode();  // 查找空闲inode
+    int find_free_inode();  // 查找空闲inode（inode表已满时自动扩展）
+    bool get_inode_bitmap_bit(uint32_t inode_num, uint32_t& bitmap_block, uint32_t& bit);  // 定位inode位图中的位
+    int find_free_run(uint32_t count);  // 查找连续count个空闲数据块，返回首块编号
+    bool grow_inode_table();  // 从数据区分配一个新的inode表块组
+    uint32_t get_inode_table_block(uint32_t index) const;  // 第index个inode表块的磁盘块号
+    std::unordered_map<uint32_t, std::vector<char>> bitmap_cache;  // 位图块缓存（块号 -> 块数据，写穿）
+    char* get_bitmap_block(uint32_t block_num);  // 获取缓存中的位图块
+    bool flush_bitmap_block(uint32_t block_num); // 将缓存中的位图块写回磁盘
+    bool load_bitmaps();  // 将所有位图块读入缓存
+    int alloc_block();      // 分配一个数据块（查找空闲块并标记为已使用）
+    int alloc_block_near(uint32_t goal);  // 优先分配指定块（保持连续），不可用时分配任意空闲块
+
+    // 文件读写（内部使用，调用者持有相应的锁）
+    int new_file(uint32_t parent, const std::string& leaf, bool update_parent);  // 在目录中新建空文件（独占持有目录锁）
+    bool valid_dir_inode(uint32_t parent, Inode& dir_inode);  // 读取并检查新建文件所在目录的inode
+    void touch_dir(uint32_t parent, time_t now);  // 更新目录的修改时间
+    int lookup_file(const std::string& name);  // 按路径查找文件的inode编号（持有目录锁）
+    int read_file_data(int inode_num, char* buffer, size_t size, off_t offset);  // 读取文件内容（共享持有inode锁）
+    int write_file_data(int inode_num, const char* buffer, size_t size, off_t offset);  // 写入文件内容（独占持有inode锁）
+
+    // 文件块映射（内部使用，将文件内的逻辑块号映射为磁盘块号）
+    uint32_t bmap(Inode& inode, uint32_t block_idx, bool alloc, bool* is_new = nullptr);  // 查找/分配逻辑块对应的磁盘块
+    uint32_t map_ptr(uint32_t& table, uint32_t index, bool alloc, bool child_is_table, bool* is_new);  // 经指针块查找/分配
+    void free_file_blocks(Inode& inode);  // 释放文件的所有数据块和间接块
+    int write_blocks(Inode& inode, const char* buffer, size_t size, off_t offset);  // 按块写入文件数据
+    bool unmap_block(Inode& inode, uint32_t block_idx);  // 解除逻辑块映射并释放对应的数据块
+    bool extent_unmap(Inode& inode, uint32_t block_idx);  // extent树中解除映射（仅支持extent首尾块）
+
+    // 尾部打包（多个小文件/文件尾部共享一个数据块，按TAIL_FRAGMENT_SIZE分片）
+    TailSlots tail_slots;    // 共享尾部块的片段占用表（挂载时重建）
+    bool load_tail_slots();  // 扫描inode表，重建共享尾部块的片段占用情况
+    bool read_tail(const Inode& inode, char* buffer);  // 读取文件的尾部数据
+    bool store_tail(Inode& inode, const char* data, uint32_t len);  // 将尾部数据存入共享块
+    void release_tail(Inode& inode);  // 释放文件占用的尾部片段
+    void free_ptr_table(uint32_t table, int depth);  // 递归释放指针块及其指向的块
+
+    // extent树映射（inode带INODE_FLAG_EXTENTS时由bmap/free_file_blocks调用）
+    uint32_t extent_map(Inode& inode, uint32_t block_idx, bool alloc, bool* is_new);  // 查找/分配逻辑块
+    bool extent_insert(Inode& inode, const Extent& ext);  // 插入一条叶子记录（必要时分裂节点）
+    void extent_free(Inode& inode);  // 释放extent树映射的所有数据块和树块
+    void extent_free_node(uint32_t block_num);  // 递归释放一个extent树块
+
+    // 元数据块缓存（LRU，缓存间接块，避免随机读大文件时反复读取指针块）
+    std::list<uint32_t> meta_lru;  // 最近使用顺序（表头为最近使用）
+    std::unordered_map<uint32_t, std::pair<std::vector<char>, std::list<uint32_t>::iterator>> meta_cache;
+    char* get_meta_block(uint32_t block_num, bool zero_fill = false);  // 获取缓存中的元数据块
+    bool flush_meta_block(uint32_t block_num);  // 将缓存中的元数据块写回磁盘
+    void drop_meta_block(uint32_t block_num);   // 从缓存中移除元数据块（块被释放时调用）
+
+    // 目录（各目录首次访问时扫描目录块建立内存状态，根目录在挂载时加载）
+    std::unordered_map<uint32_t, DirState> dir_states;  // 目录inode -> 已加载的目录状态
+    uint32_t dir_versions;  // 目录版本计数（加载目录持有目录状态锁，增删目录项独占持有目录锁，二者互斥）
+    DirState* get_dir(uint32_t dir);  // 获取目录状态（未加载时加载）；不是目录返回nullptr
+    bool load_dir(uint32_t dir, DirState& state);  // 扫描目录块，建立目录状态
+    int dir_grow(uint32_t dir, DirState& state);  // 为线性目录追加一个目录块，返回其逻辑块号
+    bool dir_convert_to_tree(uint32_t dir, DirState& state);  // 将线性目录转换为B+树目录
+    int dir_lookup(uint32_t dir, const char* name, size_t len, uint8_t* type = nullptr);  // 按文件名查找inode编号
+    bool dir_add(uint32_t dir, const std::string& name, uint32_t inode_num, uint8_t type);  // 添加目录项
+    bool dir_remove(uint32_t dir, const std::string& name);  // 移除目录项
+    bool dir_is_empty(uint32_t dir);  // 目录是否不含任何目录项（"."除外）
+    bool dir_upgrade(uint32_t dir, Inode& dir_inode);  // 将定长目录项格式的旧目录转换为变长记录格式
+    void dir_build_bloom(DirState& state);  // 按B+树中现有文件名重建布隆过滤器
+
+    // 路径解析（以"/"分隔，开头的"/"可省略，"."与".."按字面处理）
+    int resolve_path(const std::string& path);  // 解析路径，返回目标inode编号
+    int resolve_parent(const std::string& path, std::string& leaf);  // 解析路径的父目录，leaf返回最后一个分量
+    int resolve_parent(const char* path, size_t len, const char*& leaf, size_t& leaf_len, size_t& entered);  // 原地逐个分量解析（不分配内存）
+
+    // B+树目录（大目录使用，树块经元数据缓存访问，查找/插入/删除读取的块数不超过树高）
+    uint32_t dtree_create();  // 创建只含空叶子的B+树，返回树根块号
+    uint32_t dtree_find_leaf(uint32_t root, const std::string& name);  // 查找文件名所在的叶子
+    int dtree_lookup(uint32_t root, const std::string& name, uint8_t* type = nullptr);  // 按文件名查找inode编号
+    bool dtree_insert(uint32_t root, const std::string& name, uint32_t inode_num, uint8_t type);  // 插入目录项（必要时分裂节点）
+    bool dtree_remove(uint32_t root, const std::string& name);  // 删除目录项
+    uint32_t dtree_first_leaf(uint32_t root);  // 最左侧叶子（按文件名顺序遍历的起点）
+    bool dtree_hash_names(uint32_t root, std::vector<size_t>& hashes);  // 收集全部文件名的哈希值（重建布隆过滤器用）
+    bool dtree_range(uint32_t root, const std::string& first, const std::string& last, std::vector<DirEntry>& entries);  // 按文件名顺序收集[first, last)内的目录项
+    bool dtree_seek(uint32_t root, const std::string& after, uint32_t& leaf, uint32_t& slot);  // 定位到第一个大于after的目录项（目录遍历重新定位用）
+    bool dtree_next(uint32_t& leaf, uint32_t& slot, DirEntry& entry);  // 读取叶子链表中的下一条目录项（目录遍历用）
+    void dtree_free(uint32_t block_num);  // 递归释放树块
+
+    // 目录项缓存（LRU，位于目录查找之前，同时缓存“文件不存在”的否定结果）
+    std::list<Dentry> dentry_lru;  // 最近使用顺序（表头为最近使用）
+    std::unordered_map<uint32_t, std::unordered_map<NameRef, std::list<Dentry>::iterator, NameRefHash>> dentry_cache;  // 目录 -> 文件名（引用条目中的name）-> 条目
+    int dentry_lookup(uint32_t dir, const char* name, size_t len, uint8_t* type = nullptr);  // 经缓存查找文件名，未命中时查询目录并缓存结果
+    int dentry_lookup(uint32_t dir, const std::string& name, uint8_t* type = nullptr) { return dentry_lookup(dir, name.data(), name.size(), type); }
+    void dentry_set(uint32_t dir, const std::string& name, int inode_num, uint8_t type = 0);  // 写入/更新缓存条目（目录项增删时调用）
+    void dentry_drop_dir(uint32_t dir);  // 移除某目录下的全部缓存条目（删除目录时调用）
+
+    // 并发控制（加锁顺序见类说明）
+    SharedMutex namespace_mutex;  // 目录锁：查找与遍历共享持有，目录项增删独占持有
+    mutable SharedMutex inode_locks[INODE_LOCK_STRIPES];  // inode锁（按编号分片）：同一文件的读共享持有，写与删除独占持有
+    std::mutex dir_states_mutex;  // 目录状态锁：dir_states的查找、按需加载与移除（共享持有目录锁的线程可能同时加载）
+    std::mutex dentry_mutex;  // 目录项缓存锁：查找命中也会调整最近使用顺序
+    std::recursive_mutex meta_mutex;  // 元数据块缓存锁：持有期间get_meta_block返回的指针不会被其他线程淘汰
+    std::recursive_mutex alloc_mutex;  // 分配器锁：位图缓存、超级块计数、共享尾部块片段
+    mutable std::mutex inode_table_mutex;  // inode表锁：inode读写、预加载的inode表副本、lazytime暂存时间
+    mutable std::mutex io_mutex;  // 磁盘文件流锁：一次定位与读写作为整体执行
+    SharedMutex& inode_lock(uint32_t inode_num) const { return inode_locks[inode_num % INODE_LOCK_STRIPES]; }
 
     bool write_super_block(); // 辅助函数：将内存中的超级块写回磁盘（保证数据一致性）
+    bool upgrade_from_v1();   // 将SIMFSv1镜像升级为SIMFSv2格式（挂载时调用）
+
+    // inode读写操作（内部使用，所有inode访问均经由这两个函数）
+    bool read_inode(uint32_t inode_num, Inode& inode) const;   // 读取inode
+    bool write_inode(uint32_t inode_num, const Inode& inode);  // 写入inode
+
+    // inode表预加载（挂载选项preload）：预加载后read_inode直接从内存返回，write_inode写穿
+    std::vector<Inode> inode_table;  // 按编号排列的inode表副本
+    bool inode_table_loaded;         // inode_table是否有效
+    bool load_inode_table();         // 以少量大块顺序读读入整个inode表
+
+    // lazytime（挂载选项lazytime）：仅时间戳变化的inode更新暂存于此，read_inode读取时合并
+    std::unordered_map<uint32_t, int64_t> pending_mtimes;  // inode编号 -> 尚未写回的修改时间
+    bool update_inode(uint32_t inode_num, const Inode& inode, const Inode& orig);  // 写回修改后的inode（仅时间戳变化时可延迟）
+    bool flush_pending_times();  // 将暂存的修改时间写回磁盘
 
     // 块读写操作（内部使用，读写指定块）
     bool read_block(uint32_t block_num, char* buffer);   // 读取块
     bool write_block(uint32_t block_num, const char* buffer);  // 写入块
+    bool read_bytes(uint32_t pos, char* buffer, size_t len);  // 读取块内的一段字节
+    bool write_bytes(uint32_t pos, const char* buffer, size_t len);  // 写入块内的一段字节
 
 public:
     /**
@@ -105,16 +647,30 @@ public:
 
     // 磁盘操作
     bool format();    // 格式化磁盘（初始化文件系统）
-    bool mount();     // 挂载磁盘（加载文件系统）
+    bool mount(const MountOptions& options = MountOptions());  // 挂载磁盘（加载文件系统）
     bool unmount();   // 卸载磁盘（保存并关闭）
+    bool sync();      // 将内存中暂存的元数据（lazytime时间戳）写回磁盘
 
-    // 文件操作
+    // 文件操作（文件名均可为路径，如"a/b/c.txt"或"/a/b/c.txt"）
     int create_file(const std::string& name);  // 创建文件，返回inode
     int open_file(const std::string& name);    // 打开文件，返回inode
     int read_file(int inode_num, char* buffer, size_t size, off_t offset);  // 读取文件
     int write_file(int inode_num, const char* buffer, size_t size, off_t offset);  // 写入文件
+    int read_path(const std::string& name, std::string& content);  // 按路径读取整个文件（查找与读取之间文件不会被删除）
+    int write_path(const std::string& name, const char* buffer, size_t size, off_t offset, int flags = 0);  // 按路径写入文件（flags见OPEN_*，打开或创建与写入为一步）
+    bool write_batch(const std::string& dir, std::vector<BatchWrite>& items);  // 批量写入或创建同一目录下的文件（目录只解析一次）
     bool delete_file(const std::string& name);  // 删除文件
-    std::vector<DirEntry> list_files();         // 列出所有文件
+    std::vector<DirEntry> list_files(const std::string& path = "/");  // 列出目录中的所有文件
+    std::vector<DirEntry> list_range(const std::string& path, const std::string& first, const std::string& last);  // 按文件名顺序列出[first, last)内的文件（last为空表示无上界）
+    std::vector<DirEntry> list_prefix(const std::string& path, const std::string& prefix);  // 按文件名顺序列出以prefix开头的文件
+
+    // 目录遍历（逐项读取，不复制整个目录）
+    bool open_dir(const std::string& path, DirCursor& cursor);  // 定位到目录的第一项
+    bool read_dir(DirCursor& cursor, DirEntry& entry);  // 读取下一项并推进游标，已到末尾返回false
+
+    // 目录操作
+    int create_dir(const std::string& path);   // 创建目录（mkdir），返回inode
+    bool delete_dir(const std::string& path);  // 删除空目录（rmdir）
 
     // 信息查询
     void print_info();                // 打印磁盘信息
@@ -1,12 +1,15 @@
 #ifndef TASK_QUEUE_H
 #define TASK_QUEUE_H
 
-#include <queue>
 #include <vector>
+#include <memory>
+#include <utility>
 #include <string>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <future>
+#include <functional>
 #include <thread>
 #include <chrono>
 #include <iostream>
@@ -14,6 +17,136 @@
 #include "disk_fs.h"
 #include "command_parser.h"
 
+const size_t TASK_RING_CAPACITY = 1024;  // 每个工作线程的任务环形队列容量（任务数，取2的幂）
+const size_t TASK_BATCH_SIZE = 8;        // 工作线程一次从自己的队列中取出并连续执行的最多任务数
+const int IDLE_SPINS = 64;               // 工作线程在队列为空时让出CPU重试的次数，之后才在条件变量上休眠
+const int FULL_SPINS = 64;               // 所有队列已满时提交者让出CPU重试的轮数，之后在条件变量上等待
+
+/**
+ * @brief 有界多生产者多消费者环形队列（无锁）
+ * 每个槽位带一个序号：序号等于入队位置时槽位可写，等于入队位置+1时可读，
+ * 读出后序号推进一整圈，供下一轮写入。生产者之间、消费者之间只在各自的位置计数器上做一次CAS，
+ * 生产者与消费者互不争用同一个锁或计数器。队列满时入队失败、为空时出队失败，由调用者决定等待方式
+ */
+template <typename T>
+class MpmcRing {
+public:
+    // 容量向上取整为2的幂
+    explicit MpmcRing(size_t capacity) : enqueue_pos(0), dequeue_pos(0) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief 入队
+     * @param item 入队的元素（成功时被移动或复制进队列，失败时不受影响）
+     * @return 成功返回true；队列已满返回false
+     */
+    template <typename U>
+    bool try_push(U&& item) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                // 槽位可写：抢占该位置（失败时pos被更新为最新位置后重试）
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::forward<U>(item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // 槽位上一轮的元素尚未被读出：队列已满
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);  // 其他生产者已写入该位置
+            }
+        }
+    }
+
+    /**
+     * @brief 出队
+     * @param item 输出参数：队首元素
+     * @return 成功返回true；队列为空返回false
+     */
+    bool try_pop(T& item) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.data);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // 槽位尚未写入：队列为空
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);  // 其他消费者已读出该位置
+            }
+        }
+    }
+
+    /**
+     * @brief 批量出队：一次CAS取走队首连续的至多max个已写入元素
+     * @param items 输出参数：接收元素的数组（至少max个元素）
+     * @param max 最多取出的元素数
+     * @return 取出的元素数；队列为空返回0
+     */
+    size_t try_pop_batch(T* items, size_t max) {
+        if (max > mask + 1) max = mask + 1;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            // 从pos起数出连续可读的槽位
+            size_t count = 0;
+            while (count < max) {
+                size_t seq = cells[(pos + count) & mask].sequence.load(std::memory_order_acquire);
+                if (seq != pos + count + 1) break;
+                count++;
+            }
+            if (count == 0) {
+                size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+                if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return 0;  // 队列为空
+                pos = dequeue_pos.load(std::memory_order_relaxed);      // 其他消费者已读出该位置
+                continue;
+            }
+            // 一次抢占[pos, pos+count)：成功后这些槽位只属于本线程（失败时pos被更新后重新计数）
+            if (dequeue_pos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < count; ++i) {
+                    Cell& cell = cells[(pos + i) & mask];
+                    items[i] = std::move(cell.data);
+                    cell.sequence.store(pos + i + mask + 1, std::memory_order_release);
+                }
+                return count;
+            }
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;  // 槽位序号（决定当前可写还是可读）
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    // 入队与出队位置分别占据独立的缓存行，避免生产者与消费者互相使对方的缓存失效
+    char pad0[64];
+    std::atomic<size_t> enqueue_pos;
+    char pad1[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos;
+    char pad2[64 - sizeof(std::atomic<size_t>)];
+};
+
 // 任务结构体：封装命令信息与执行状态
 struct Task {
     CommandType type;               // 命令类型（如LS、COPY）
@@ -21,52 +154,254 @@ struct Task {
     std::string result;             // 执行结果
     bool completed;                 // 完成标记
     std::chrono::steady_clock::time_point start_time; // 任务开始时间（用于性能统计）
+    std::function<void()> action;   // 自定义操作（非空时代替命令执行，如在工作线程中继续提交任务）
 };
 
 // 线程池类：管理多线程任务执行
+// 每个工作线程有自己的任务队列：外部提交的任务轮流放入各队列，工作线程执行中提交的任务放入自己的队列；
+// 工作线程先取自己队列中的任务，自己的队列为空时从其他工作线程的队列中窃取
 class ThreadPool {
 private:
-    std::queue<Task> task_queue;    // 任务队列（生产者-消费者模型）
+    // 队列中的任务：任务本身及其完成通知（执行完后写入任务结果）
+    struct QueuedTask {
+        Task task;
+        std::promise<std::string> done;
+    };
+
+    std::vector<std::unique_ptr<MpmcRing<QueuedTask>>> task_queues; // 各工作线程的任务队列（无锁环形队列，可被其他线程窃取）
+    std::atomic<size_t> next_queue; // 外部提交任务时轮流选择的队列编号
     std::vector<std::thread> workers; // 工作线程数组
-    std::mutex queue_mutex;         // 队列操作互斥锁
-    std::condition_variable cv;     // 条件变量（用于线程唤醒）
+    std::mutex idle_mutex;          // 空闲等待互斥锁（只在工作线程找不到任务时使用）
+    std::condition_variable cv;     // 条件变量（用于唤醒空闲的工作线程）
+    std::atomic<size_t> idle_workers; // 正在条件变量上等待的工作线程数
     std::atomic<bool> running;      // 线程池运行状态
-    DiskFS* disk_ptr;               // 磁盘操作实例指针
-    std::mutex disk_mutex;          // 磁盘操作互斥锁（保证线程安全）
-    std::atomic<size_t> active_tasks; // 活跃任务计数器
+    DiskFS* disk_ptr;               // 磁盘操作实例指针（DiskFS内部加锁，各线程可直接并发调用）
+    std::mutex output_mutex;        // 输出互斥锁（避免不同任务的输出交错）
+    std::atomic<size_t> active_tasks; // 活跃任务计数器（已提交但尚未执行完的任务，含排队中的任务）
+    std::mutex done_mutex;          // 完成等待互斥锁
+    std::condition_variable done_cv; // 活跃任务数归零时通知wait_for_completion
+    std::mutex full_mutex;          // 队列已满等待互斥锁（只在所有队列均已满时使用）
+    std::condition_variable full_cv; // 工作线程取走任务后唤醒等待队列空位的提交者
+    std::atomic<size_t> full_waiters; // 正在条件变量上等待队列空位的提交者数
+
+    // 当前线程所在的线程池与工作线程编号（不是工作线程时线程池为nullptr）
+    static std::pair<ThreadPool*, size_t>& current_worker() {
+        static thread_local std::pair<ThreadPool*, size_t> worker(nullptr, 0);
+        return worker;
+    }
+
+    /**
+     * @brief 查找任务：先从自己的队列中批量取出任务，再依次从其他工作线程的队列中窃取
+     * @param index 工作线程编号
+     * @param batch 输出参数：接收任务的数组（至少TASK_BATCH_SIZE个元素）
+     * @return 取出的任务数；所有队列均为空返回0
+     * 窃取时只取一个任务，其余任务留给队列的所有者与其他空闲的工作线程
+     */
+    size_t find_tasks(size_t index, QueuedTask* batch) {
+        size_t count = task_queues[index]->try_pop_batch(batch, TASK_BATCH_SIZE);
+        if (count == 0) {
+            for (size_t i = 1; i < task_queues.size(); ++i) {
+                if (task_queues[(index + i) % task_queues.size()]->try_pop(batch[0])) {
+                    count = 1;
+                    break;
+                }
+            }
+        }
+        if (count > 0) notify_not_full();
+        return count;
+    }
+
+    // 取走任务后唤醒等待队列空位的提交者（只有存在等待者时才加锁）
+    void notify_not_full() {
+        // 与add_task中的栅栏配对：要么提交者重试时看到空位，要么本线程看到full_waiters>0并发出通知
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (full_waiters > 0) {
+            std::lock_guard<std::mutex> lock(full_mutex);
+            full_cv.notify_all();
+        }
+    }
+
+    // 从first号队列起依次尝试出队，所有队列均为空返回false
+    bool pop_any(size_t first, QueuedTask& queued) {
+        for (size_t i = 0; i < task_queues.size(); ++i) {
+            if (task_queues[(first + i) % task_queues.size()]->try_pop(queued)) {
+                notify_not_full();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 从first号队列起依次尝试入队，所有队列均已满返回false（任务不受影响）
+    bool push_any(size_t first, QueuedTask& queued) {
+        for (size_t i = 0; i < task_queues.size(); ++i) {
+            if (task_queues[(first + i) % task_queues.size()]->try_push(std::move(queued))) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 取出接下来要执行的任务：先无锁重试若干次，仍为空时在条件变量上休眠
+     * @param index 工作线程编号
+     * @param batch 输出参数：接收任务的数组（至少TASK_BATCH_SIZE个元素）
+     * @return 取出的任务数；线程池已停止且队列为空返回0
+     */
+    size_t next_tasks(size_t index, QueuedTask* batch) {
+        size_t count = 0;
+        for (int i = 0; i < IDLE_SPINS; ++i) {
+            if ((count = find_tasks(index, batch)) > 0) return count;
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle_workers++;
+        // 与add_task中的栅栏配对：要么本线程看到新任务，要么生产者看到idle_workers>0并发出通知
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while ((count = find_tasks(index, batch)) == 0) {
+            if (!running) {
+                idle_workers--;
+                return 0;
+            }
+            cv.wait(lock);
+        }
+        idle_workers--;
+        return count;
+    }
 
     // 工作线程执行函数
-    void worker() {
-        while (running) {
-            Task task;
-            {
-                // 加锁等待任务
-                std::unique_lock<std::mutex> lock(queue_mutex);
-                // 等待条件：队列非空或线程池停止
-                cv.wait(lock, [this] { return !task_queue.empty() || !running; });
-                // 线程池停止且队列为空时退出
-                if (!running && task_queue.empty()) break;
-                if (task_queue.empty()) continue;
-
-                // 取出任务并递增活跃计数器
-                task = task_queue.front();
-                task_queue.pop();
-                active_tasks++;
+    void worker(size_t index) {
+        current_worker() = std::make_pair(this, index);
+        std::vector<QueuedTask> batch(TASK_BATCH_SIZE);
+        while (true) {
+            // 线程池停止且所有队列均为空时退出（退出命令之前提交的任务可能仍在其他队列中，需执行完）
+            size_t count = next_tasks(index, &batch[0]);
+            if (count == 0) break;
+            // 连续执行本批任务（同一批任务多访问相近的文件与目录，目录项缓存和元数据块缓存保持命中）
+            for (size_t i = 0; i < count; ) {
+                i += run_group(&batch[i], count - i);
             }
+        }
+    }
 
-            // 执行任务
+    /**
+     * @brief 执行一组任务：开头相邻的同一目录下的WRITE/TOUCH任务经DiskFS::write_batch合并执行，
+     *        所在目录只解析一次，目录的修改时间只写回一次；其他任务单独执行
+     * @param tasks 本批中尚未执行的任务
+     * @param count 任务数
+     * @return 执行的任务数（至少1个）
+     * 只合并相邻的任务，与其他任务（如RM）之间的先后顺序不变
+     */
+    size_t run_group(QueuedTask* tasks, size_t count) {
+        std::string dir, next_dir, leaf;
+        size_t n = 0;
+        if (batchable(tasks[0].task, dir, leaf)) {
+            for (n = 1; n < count && batchable(tasks[n].task, next_dir, leaf) && next_dir == dir; ++n) {}
+        }
+        if (n < 2) {
+            run_task(tasks[0]);
+            return 1;
+        }
+
+        std::vector<BatchWrite> items(n);
+        std::vector<std::string> contents(n);
+        for (size_t i = 0; i < n; ++i) {
+            Task& task = tasks[i].task;
             task.start_time = std::chrono::steady_clock::now();
-            try {
-                std::lock_guard<std::mutex> disk_lock(disk_mutex); // 磁盘操作加锁
-                execute_task(task); // 执行具体命令
-            } catch (...) {
-                task.result = "错误：任务执行异常";
+            batchable(task, next_dir, items[i].name);
+            items[i].touch = task.type == CommandType::TOUCH;
+            if (!items[i].touch) {
+                contents[i] = write_content(task);
+                items[i].data = contents[i].data();
+                items[i].size = contents[i].size();
             }
+        }
+
+        bool done = false;
+        try {
+            done = disk_ptr->write_batch(dir, items);
+        } catch (...) {
+            for (size_t i = 0; i < n; ++i) {
+                tasks[i].task.result = "错误：任务执行异常";
+                finish_task(tasks[i]);
+            }
+            return n;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (!done) {
+                run_task(tasks[i]);  // 目录不存在：逐个执行，给出各自的错误信息
+            } else {
+                tasks[i].task.result = items[i].touch
+                    ? touch_result(items[i].inode_num, items[i].created)
+                    : write_result(items[i].result, items[i].size);
+                finish_task(tasks[i]);
+            }
+        }
+        return n;
+    }
 
-            // 任务完成处理
-            active_tasks--;
-            task.completed = true;
+    /**
+     * @brief 判断任务能否与相邻任务合并执行（无自定义操作、参数完整的WRITE/TOUCH，文件名不含"."与".."）
+     * @param task 任务
+     * @param dir 输出参数：所在目录的路径（根目录为"/"）
+     * @param leaf 输出参数：文件名
+     */
+    static bool batchable(const Task& task, std::string& dir, std::string& leaf) {
+        if (task.action) return false;
+        if (task.type == CommandType::WRITE ? task.args.size() < 2 : task.type != CommandType::TOUCH || task.args.empty()) {
+            return false;
+        }
+        const std::string& path = task.args[0];
+        size_t slash = path.rfind('/');
+        dir = slash == std::string::npos ? "/" : path.substr(0, slash + 1);
+        leaf = slash == std::string::npos ? path : path.substr(slash + 1);
+        return !leaf.empty() && leaf != "." && leaf != "..";
+    }
+
+    // WRITE任务的写入内容：合并参数（支持空格），去除首尾引号
+    static std::string write_content(const Task& task) {
+        std::string content;
+        for (size_t i = 1; i < task.args.size(); ++i) {
+            if (i > 1) content += " ";
+            content += task.args[i];
+        }
+        if (content.size() >= 2 && content.front() == '"' && content.back() == '"') {
+            content = content.substr(1, content.size() - 2);
+        }
+        return content;
+    }
+
+    static std::string write_result(int bytes_written, size_t size) {
+        if (bytes_written != (int)size) return "错误: 写入文件失败\n";
+        return "写入成功（文件大小：" + std::to_string(size) + "字节）\n";
+    }
 
+    static std::string touch_result(int inode, bool created) {
+        if (inode == -1) return "错误: 创建文件失败（可能文件名过长或根目录已满）\n";
+        if (!created) return "文件已存在（修改时间已更新）\n";
+        return "空文件创建成功（inode: " + std::to_string(inode) + "）\n";
+    }
+
+    // 执行一个任务，输出结果并通知等待者
+    void run_task(QueuedTask& queued) {
+        Task& task = queued.task;
+
+        // 执行任务（不同文件上的任务并行执行，互斥由DiskFS内部的细粒度锁保证）
+        task.start_time = std::chrono::steady_clock::now();
+        try {
+            execute_task(task); // 执行具体命令
+        } catch (...) {
+            task.result = "错误：任务执行异常";
+        }
+        finish_task(queued);
+    }
+
+    // 任务完成处理：输出结果并通知等待者
+    void finish_task(QueuedTask& queued) {
+        Task& task = queued.task;
+        task.completed = true;
+
+        {
+            std::lock_guard<std::mutex> output_lock(output_mutex);
             // 输出结果（空结果不输出）
             if (!task.result.empty()) {
                 std::cout << task.result;
@@ -80,21 +415,54 @@ private:
                 running = false;
             }
         }
+
+        // 输出完成后再通知等待者（任务结果交给add_task返回的future）
+        queued.done.set_value(std::move(task.result));
+        if (--active_tasks == 0) {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done_cv.notify_all();
+        }
     }
 
     // 执行具体任务（迁移自main.cpp的consumer_thread逻辑）
     void execute_task(Task& task) {
+        if (task.action) {
+            task.action();
+            return;
+        }
         switch (task.type) {
             case CommandType::LS: {
-                std::vector<DirEntry> entries = disk_ptr->list_files();
-                std::stringstream ss;
-                ss << "文件列表:\n";
-                for (const auto& entry : entries) {
-                    if (entry.valid && entry.inode_num != 0) {
-                        ss << "  " << entry.name << " (inode: " << entry.inode_num << ")\n";
+                // 参数以"*"结尾时按前缀列出（如"ls test_*"、"ls docs/copy_*"），结果按文件名排序
+                if (!task.args.empty() && !task.args[0].empty() && task.args[0].back() == '*') {
+                    std::string pattern = task.args[0].substr(0, task.args[0].size() - 1);
+                    size_t slash = pattern.rfind('/');
+                    std::string dir = slash == std::string::npos ? "/" : pattern.substr(0, slash + 1);
+                    std::string prefix = slash == std::string::npos ? pattern : pattern.substr(slash + 1);
+                    std::vector<DirEntry> entries = disk_ptr->list_prefix(dir, prefix);
+                    std::stringstream ss;
+                    ss << "文件列表:\n";
+                    for (const auto& entry : entries) {
+                        ss << "  " << entry.name << (entry.type == 2 ? "/" : "") << " (inode: " << entry.inode_num << ")\n";
+                    }
+                    task.result = ss.str();
+                    break;
+                }
+
+                // 经目录遍历游标逐项输出，大目录也不在内存中汇总整个列表（输出期间持有输出锁）
+                DirCursor cursor;
+                if (!disk_ptr->open_dir(task.args.empty() ? "/" : task.args[0], cursor)) {
+                    task.result = "错误: 目录不存在\n";
+                    break;
+                }
+                std::lock_guard<std::mutex> output_lock(output_mutex);
+                std::cout << "文件列表:\n";
+                DirEntry entry;
+                while (disk_ptr->read_dir(cursor, entry)) {
+                    if (entry.inode_num != 0) {
+                        // 目录名后加"/"以区分普通文件
+                        std::cout << "  " << entry.name << (entry.type == 2 ? "/" : "") << " (inode: " << entry.inode_num << ")\n";
                     }
                 }
-                task.result = ss.str();
                 break;
             }
 
@@ -103,28 +471,17 @@ private:
                     task.result = "错误: 缺少文件名参数（用法：cat <文件名>）\n";
                     break;
                 }
+                // 查找与读取为一步（期间文件不会被并发的RM删除）
                 std::string filename = task.args[0];
-                int inode = disk_ptr->open_file(filename);
-                if (inode == -1) {
-                    task.result = "错误: 文件不存在\n";
-                    break;
-                }
-                
-                int file_size = disk_ptr->get_file_size(inode);
-                if (file_size <= 0) {
-                    task.result = "文件为空\n";
-                    break;
-                }
-
-                char* buffer = new char[file_size + 1];
-                int bytes_read = disk_ptr->read_file(inode, buffer, file_size, 0);
+                std::string content;
+                int bytes_read = disk_ptr->read_path(filename, content);
                 if (bytes_read < 0) {
-                    task.result = "错误: 读取文件失败\n";
+                    task.result = "错误: 文件不存在或读取失败\n";
+                } else if (bytes_read == 0) {
+                    task.result = "文件为空\n";
                 } else {
-                    buffer[bytes_read] = '\0';
-                    task.result = "文件内容:\n" + std::string(buffer) + "\n";
+                    task.result = "文件内容:\n" + std::string(content.c_str()) + "\n";
                 }
-                delete[] buffer;
                 break;
             }
 
@@ -147,37 +504,24 @@ private:
                 std::string src = task.args[0];
                 std::string dest = task.args[1];
 
-                int src_inode = disk_ptr->open_file(src);
-                if (src_inode == -1) {
+                // 读取源文件、创建并写入目标文件各为一步（期间文件不会被并发的RM删除或复用）
+                std::string content;
+                int bytes_read = disk_ptr->read_path(src, content);
+                if (bytes_read < 0) {
                     task.result = "错误: 源文件不存在\n";
                     break;
                 }
 
-                int dest_inode = disk_ptr->create_file(dest);
-                if (dest_inode == -1) {
+                int bytes_written = disk_ptr->write_path(dest, content.data(), content.size(), 0, OPEN_CREATE | OPEN_EXCL);
+                if (bytes_written == -1) {
                     task.result = "错误: 目标文件创建失败（可能已存在）\n";
                     break;
                 }
-
-                int file_size = disk_ptr->get_file_size(src_inode);
-                if (file_size <= 0) {
+                if (bytes_read == 0) {
                     task.result = "源文件为空，复制完成\n";
                     break;
                 }
 
-                char* buffer = new char[file_size];
-                int bytes_read = disk_ptr->read_file(src_inode, buffer, file_size, 0);
-                
-                if (bytes_read < 0) {
-                    task.result = "错误: 读取源文件失败\n";
-                    disk_ptr->delete_file(dest);
-                    delete[] buffer;
-                    break;
-                }
-
-                int bytes_written = disk_ptr->write_file(dest_inode, buffer, bytes_read, 0);
-                delete[] buffer;
-
                 if (bytes_written != bytes_read) {
                     task.result = "错误: 写入目标文件失败\n";
                     disk_ptr->delete_file(dest);
@@ -193,34 +537,11 @@ private:
                     break;
                 }
                 std::string filename = task.args[0];
-                std::string content;
-
-                // 合并参数为内容（支持空格）
-                for (size_t i = 1; i < task.args.size(); ++i) {
-                    if (i > 1) content += " ";
-                    content += task.args[i];
-                }
-
-                // 去除首尾引号
-                if (content.size() >= 2 && content.front() == '"' && content.back() == '"') {
-                    content = content.substr(1, content.size() - 2);
-                }
-
-                int inode = disk_ptr->open_file(filename);
-                if (inode == -1) {
-                    inode = disk_ptr->create_file(filename);
-                    if (inode == -1) {
-                        task.result = "错误: 创建文件失败\n";
-                        break;
-                    }
-                }
+                std::string content = write_content(task);
 
-                int bytes_written = disk_ptr->write_file(inode, content.c_str(), content.size(), 0);
-                if (bytes_written != (int)content.size()) {
-                    task.result = "错误: 写入文件失败\n";
-                } else {
-                    task.result = "写入成功（文件大小：" + std::to_string(content.size()) + "字节）\n";
-                }
+                // 打开或创建与写入为一步（文件不会在两者之间被删除，其inode编号也不会被复用）
+                int bytes_written = disk_ptr->write_path(filename, content.c_str(), content.size(), 0, OPEN_CREATE);
+                task.result = write_result(bytes_written, content.size());
                 break;
             }
 
@@ -233,19 +554,39 @@ private:
 
                 int inode = disk_ptr->open_file(filename);
                 if (inode != -1) {
-                    task.result = "文件已存在（修改时间已更新）\n";
+                    task.result = touch_result(inode, false);
                     break;
                 }
 
                 inode = disk_ptr->create_file(filename);
+                task.result = touch_result(inode, true);
+                break;
+            }
+
+            case CommandType::MKDIR: {
+                if (task.args.size() < 1) {
+                    task.result = "错误: 缺少目录名（用法：mkdir <路径>）\n";
+                    break;
+                }
+                int inode = disk_ptr->create_dir(task.args[0]);
                 if (inode == -1) {
-                    task.result = "错误: 创建文件失败（可能文件名过长或根目录已满）\n";
+                    task.result = "错误: 创建目录失败（可能已存在或父目录不存在）\n";
                 } else {
-                    task.result = "空文件创建成功（inode: " + std::to_string(inode) + "）\n";
+                    task.result = "目录创建成功（inode: " + std::to_string(inode) + "）\n";
                 }
                 break;
             }
 
+            case CommandType::RMDIR: {
+                if (task.args.size() < 1) {
+                    task.result = "错误: 缺少目录名（用法：rmdir <路径>）\n";
+                    break;
+                }
+                bool success = disk_ptr->delete_dir(task.args[0]);
+                task.result = success ? "目录删除成功\n" : "删除失败（目录不存在或不是空目录）\n";
+                break;
+            }
+
             case CommandType::EMPTY:
                 task.result = ""; // 空输入不输出
                 break;
@@ -255,34 +596,86 @@ private:
                 break;
 
             default:
-                task.result = "未知命令，支持命令：ls/cat/rm/copy/write/touch/exit \n";
+                task.result = "未知命令，支持命令：ls/cat/rm/copy/write/touch/mkdir/rmdir/exit \n";
         }
     }
 
 public:
     // 构造函数：初始化线程池
     ThreadPool(DiskFS* disk, size_t thread_count = std::thread::hardware_concurrency()) 
-        : running(true), disk_ptr(disk), active_tasks(0) {
+        : next_queue(0), idle_workers(0), running(true), disk_ptr(disk), active_tasks(0), full_waiters(0) {
+        if (thread_count == 0) thread_count = 1; // 无法获取CPU核心数时至少使用一个工作线程
+        for (size_t i = 0; i < thread_count; ++i) {
+            task_queues.emplace_back(new MpmcRing<QueuedTask>(TASK_RING_CAPACITY));
+        }
         // 创建工作线程（默认使用CPU核心数）
         for (size_t i = 0; i < thread_count; ++i) {
-            workers.emplace_back(&ThreadPool::worker, this);
+            workers.emplace_back(&ThreadPool::worker, this, i);
         }
     }
 
     // 析构函数：停止线程池并回收资源
     ~ThreadPool() {
         running = false;
-        cv.notify_all(); // 唤醒所有等待的线程
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            cv.notify_all(); // 唤醒所有等待的线程
+        }
         for (auto& t : workers) {
             if (t.joinable()) t.join(); // 等待线程结束
         }
     }
 
-    // 添加任务到队列
-    void add_task(const Task& task) {
-        std::lock_guard<std::mutex> lock(queue_mutex);
-        task_queue.push(task);
-        cv.notify_one(); // 唤醒一个工作线程（避免惊群效应）
+    /**
+     * @brief 添加任务到队列（工作线程执行任务时提交的任务放入自己的队列，外部提交的任务轮流放入各队列）
+     * @param task 待执行的任务
+     * @return 任务执行完（结果已输出）后就绪的future，值为任务结果Task::result
+     * 选中的队列已满时依次尝试其他队列。所有队列均已满时：工作线程从自己的队列（为空时从其他队列）
+     * 取出队首任务执行以腾出空位，再重试入队（等待其他工作线程腾出空位可能互相等待）；
+     * 其他线程先让出CPU重试若干轮，再在条件变量上等待工作线程取走任务。
+     * 被取出的任务嵌套在当前任务中执行，但仍是按队列顺序最先出队的任务；
+     * 不同队列之间（含窃取）不保证执行顺序，需要先后顺序的任务应等待前一个任务的future
+     */
+    std::future<std::string> add_task(const Task& task) {
+        QueuedTask queued;
+        queued.task = task;
+        std::future<std::string> result = queued.done.get_future();
+        active_tasks++;
+        bool from_worker = current_worker().first == this;
+        size_t first = from_worker
+            ? current_worker().second
+            : next_queue.fetch_add(1, std::memory_order_relaxed) % task_queues.size();
+        if (!push_any(first, queued)) {
+            bool pushed = false;
+            if (from_worker) {
+                QueuedTask ahead;
+                while (!(pushed = push_any(first, queued))) {
+                    if (pop_any(first, ahead)) {
+                        run_task(ahead);
+                    } else {
+                        std::this_thread::yield();  // 队列刚被其他工作线程取空：重试入队
+                    }
+                }
+            }
+            for (int i = 0; i < FULL_SPINS && !pushed; ++i) {
+                std::this_thread::yield();
+                pushed = push_any(first, queued);
+            }
+            if (!pushed) {
+                std::unique_lock<std::mutex> lock(full_mutex);
+                full_waiters++;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (!push_any(first, queued)) full_cv.wait(lock);
+                full_waiters--;
+            }
+        }
+        // 只有存在休眠的工作线程时才加锁通知（忙碌时入队不涉及任何锁）
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (idle_workers > 0) {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            cv.notify_one(); // 唤醒一个工作线程（避免惊群效应）
+        }
+        return result;
     }
 
     // 获取当前活跃任务数
@@ -290,11 +683,10 @@ public:
         return active_tasks.load();
     }
 
-    // 等待所有任务完成
+    // 等待所有任务完成（最后一个任务完成时由工作线程通知，等待单个任务可使用add_task返回的future）
     void wait_for_completion() {
-        while (active_tasks > 0 || !task_queue.empty()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [this] { return active_tasks == 0; });
     }
 };
 
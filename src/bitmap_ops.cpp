@@ -1,6 +1,7 @@
 #include "../include/disk_fs.h"
 #include <cstring>
 #include <iostream>
+#include <algorithm>
 
 /**
  * @brief 更新块位图（标记数据块为"已使用"或"空闲"）
@@ -10,6 +11,7 @@
  * 块位图是管理数据块分配的核心结构，1位代表1个数据块的状态
  */
 bool DiskFS::set_block_bitmap(uint32_t block_num, bool used) {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
     // 1. 精确检查块编号是否在数据区范围内（[data_start, data_start + data_blocks)）
     uint32_t data_end = super_block.data_start + super_block.data_blocks;
 
@@ -36,9 +38,9 @@ bool DiskFS::set_block_bitmap(uint32_t block_num, bool used) {
     // 目标块位图块的实际磁盘块号（起始块 + 索引）
     uint32_t target_bitmap_block = super_block.block_bitmap + bitmap_block_idx;
 
-    // 4. 读取目标块位图块到缓冲区
-    char buffer[BLOCK_SIZE];
-    if (!read_block(target_bitmap_block, buffer)) {
+    // 4. 获取目标块位图块（位图缓存，未命中时从磁盘读取）
+    char* buffer = get_bitmap_block(target_bitmap_block);
+    if (buffer == nullptr) {
         return false; // 读取失败
     }
 
@@ -70,7 +72,7 @@ bool DiskFS::set_block_bitmap(uint32_t block_num, bool used) {
     }
 
     // 7. 将更新后的块位图块写回磁盘
-    if (!write_block(target_bitmap_block, buffer)) {
+    if (!flush_bitmap_block(target_bitmap_block)) {
         return false; // 写入失败
     }
 
@@ -84,6 +86,31 @@ bool DiskFS::set_block_bitmap(uint32_t block_num, bool used) {
 
 
 
+/**
+ * @brief 定位inode在inode位图中的位置
+ * @param inode_num 目标inode的编号
+ * @param bitmap_block 输出参数：所在inode位图块的磁盘块号
+ * @param bit 输出参数：块内的位索引
+ * @return inode编号有效返回true；否则返回false
+ * 前MAX_INODES个inode使用固定inode位图，其后的inode使用各自块组首块中的位图
+ */
+bool DiskFS::get_inode_bitmap_bit(uint32_t inode_num, uint32_t& bitmap_block, uint32_t& bit)
+{
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    if (inode_num >= super_block.total_inodes) return false;
+
+    uint32_t bits_per_block = BLOCK_SIZE * 8;
+    if (inode_num < (uint32_t)MAX_INODES) {
+        bitmap_block = super_block.inode_bitmap + inode_num / bits_per_block;
+        bit = inode_num % bits_per_block;
+    } else {
+        uint32_t idx = inode_num - MAX_INODES;
+        bitmap_block = super_block.inode_chunks[idx / INODE_CHUNK_INODES];
+        bit = idx % INODE_CHUNK_INODES;
+    }
+    return true;
+}
+
 /**
  * @brief 更新inode位图（标记inode为"已使用"或"空闲"）
  * @param inode_num 目标inode的编号
@@ -93,37 +120,25 @@ bool DiskFS::set_block_bitmap(uint32_t block_num, bool used) {
  */
 bool DiskFS::set_inode_bitmap(uint32_t inode_num, bool used)
 {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
     // 1. 检查inode编号是否在有效范围内（0~总inode数-1）
     if (inode_num >= super_block.total_inodes) {
         return false;
     }
 
-    // 2. 计算inode位图每个块可存储的位数（1块=BLOCK_SIZE字节=BLOCK_SIZE*8位）
-    uint32_t bits_per_block = BLOCK_SIZE * 8;
-
-    // 3. 计算目标inode所在的inode位图块索引（处理跨多个块的情况）
-    uint32_t bitmap_block_idx = inode_num / bits_per_block;
-
-    // inode 位图所占磁盘块数
-    uint32_t inode_bitmap_total_bytes = (MAX_INODES + 7) / 8;
-    uint32_t inode_bitmap_size = (inode_bitmap_total_bytes + BLOCK_SIZE - 1) / BLOCK_SIZE;
-
-    // 检查索引是否超出inode位图总块数（确保在有效范围内）
-    if (bitmap_block_idx >= inode_bitmap_size) {
+    // 2. 定位目标inode所在的inode位图块及块内位索引（固定inode区或动态块组）
+    uint32_t target_bitmap_block, bit_in_block;
+    if (!get_inode_bitmap_bit(inode_num, target_bitmap_block, bit_in_block)) {
         return false;
     }
 
-    // 目标inode位图块的实际磁盘块号（起始块 + 索引）
-    uint32_t target_bitmap_block = super_block.inode_bitmap + bitmap_block_idx;
-
-    // 4. 读取目标inode位图块到缓冲区
-    char buffer[BLOCK_SIZE];
-    if (!read_block(target_bitmap_block, buffer)) {
+    // 3. 获取目标inode位图块（位图缓存，未命中时从磁盘读取）
+    char* buffer = get_bitmap_block(target_bitmap_block);
+    if (buffer == nullptr) {
         return false; // 读取失败
     }
 
-    // 5. 计算目标inode在当前位图块内的位置
-    uint32_t bit_in_block = inode_num % bits_per_block; // 块内位索引
+    // 4. 计算目标inode在当前位图块内的位置
     uint32_t byte = bit_in_block / 8; // 所在字节下标（0~BLOCK_SIZE-1）
     uint8_t bit = bit_in_block % 8;   // 字节内的位下标（0~7）
 
@@ -132,7 +147,7 @@ bool DiskFS::set_inode_bitmap(uint32_t inode_num, bool used)
         return false;
     }
 
-    // 6. 更新位图位状态，并修正空闲inode计数
+    // 5. 更新位图位状态，并修正空闲inode计数
     if (used) {
         // 从"空闲"转为"使用"时才减空闲数
         bool is_currently_free = !(buffer[byte] & (1 << bit));
@@ -149,12 +164,12 @@ bool DiskFS::set_inode_bitmap(uint32_t inode_num, bool used)
         }
     }
 
-    // 7. 将更新后的inode位图块写回磁盘
-    if (!write_block(target_bitmap_block, buffer)) {
+    // 6. 将更新后的inode位图块写回磁盘
+    if (!flush_bitmap_block(target_bitmap_block)) {
         return false; // 写入失败
     }
 
-    // 8. 同步内存中的超级块到磁盘（保证数据一致性）
+    // 7. 同步内存中的超级块到磁盘（保证数据一致性）
     if (!write_super_block()) {
         return false; // 超级块同步失败
     }
@@ -169,10 +184,10 @@ bool DiskFS::set_inode_bitmap(uint32_t inode_num, bool used)
  * 遍历块位图，返回第一个位为0（空闲）的块编号
  */
 int DiskFS::find_free_block() {
-    char buffer[BLOCK_SIZE];  // 存储块位图数据的缓冲区
-
-    // 读取块位图所在的块（简化为1个块）
-    if (!read_block(super_block.block_bitmap, buffer)) return -1;
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    // 获取块位图所在的块（简化为1个块）
+    char* buffer = get_bitmap_block(super_block.block_bitmap);
+    if (buffer == nullptr) return -1;
 
     uint32_t total_data_blocks = super_block.data_blocks;  // 总数据块数（从超级块获取）
     
@@ -191,46 +206,164 @@ int DiskFS::find_free_block() {
 }
 
 /**
- * @brief 查找第一个空闲的inode（从inode位图中寻找未使用的inode）
- * @return 找到的空闲inode编号；无空闲inode或IO失败返回-1
- * 遍历inode位图（支持跨多个块），返回第一个位为0（空闲）的inode编号
+ * @brief 分配一个数据块：查找空闲块并在块位图中标记为已使用
+ * @return 分配到的块编号；无空闲块或IO失败返回-1
  */
-int DiskFS::find_free_inode() {
-    // 1. 计算关键参数
-    uint32_t bits_per_block = BLOCK_SIZE * 8;  // 每个块能存储的inode数（1字节=8位）
-    // 动态计算inode位图总块数（也可从超级块添加inode_bitmap_size字段直接获取）
-    uint32_t inode_bitmap_size = (super_block.total_inodes + bits_per_block - 1) / bits_per_block;
-    char buffer[BLOCK_SIZE];
-
-    // 2. 遍历所有inode位图块
-    for (uint32_t bm_block_idx = 0; bm_block_idx < inode_bitmap_size; bm_block_idx++) {
-        // 当前inode位图块的实际磁盘块号（起始块 + 索引）
-        uint32_t target_bm_block = super_block.inode_bitmap + bm_block_idx;
-        
-        // 读取当前inode位图块到缓冲区
-        if (!read_block(target_bm_block, buffer)) {
-            continue;  // 读取失败，尝试下一个块（实际应处理错误）
-        }
+int DiskFS::alloc_block() {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    int block_num = find_free_block();
+    if (block_num == -1) return -1;
+    if (!set_block_bitmap(block_num, true)) return -1;
+    return block_num;
+}
 
-        // 3. 遍历当前块内的每一位
-        for (uint32_t byte = 0; byte < BLOCK_SIZE; byte++) {
-            for (uint8_t bit = 0; bit < 8; bit++) {
-                // 计算当前位对应的全局inode编号（整个位图中的绝对索引）
-                uint32_t global_inode_num = bm_block_idx * bits_per_block + byte * 8 + bit;
-                
-                // 边界检查：不超出总inode数（避免无效inode）
-                if (global_inode_num >= super_block.total_inodes) {
-                    return -1;
-                }
-
-                // 检查当前位是否为0（空闲inode）
-                if (!(buffer[byte] & (1 << bit))) {
-                    return global_inode_num;  // 返回找到的第一个空闲inode编号
-                }
+/**
+ * @brief 优先分配指定的数据块（用于让文件的块保持物理连续）
+ * @param goal 期望分配的块编号（通常为文件上一块的下一块）
+ * @return 分配到的块编号：goal空闲时即为goal，否则为任意空闲块；无空闲块或IO失败返回-1
+ */
+int DiskFS::alloc_block_near(uint32_t goal) {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    uint32_t data_end = super_block.data_start + super_block.data_blocks;
+    if (goal >= super_block.data_start && goal < data_end) {
+        // 读取goal所在的块位图块，检查其是否空闲
+        uint32_t idx = goal - super_block.data_start;
+        uint32_t bits_per_block = BLOCK_SIZE * 8;
+        char* buffer = get_bitmap_block(super_block.block_bitmap + idx / bits_per_block);
+        if (buffer != nullptr) {
+            uint32_t bit_in_block = idx % bits_per_block;
+            if (!(buffer[bit_in_block / 8] & (1 << (bit_in_block % 8)))) {
+                if (set_block_bitmap(goal, true)) return (int)goal;
             }
         }
     }
+    return alloc_block();  // goal不可用，退化为普通分配
+}
 
-    // 遍历完所有inode位图块，无空闲inode
+/**
+ * @brief 查找连续count个空闲数据块（用于分配inode表块组等需要连续空间的结构）
+ * @param count 需要的连续块数
+ * @return 首块的块编号；没有足够长的连续空闲区域或IO失败返回-1
+ */
+int DiskFS::find_free_run(uint32_t count) {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    char* buffer = nullptr;
+    uint32_t bits_per_block = BLOCK_SIZE * 8;
+    uint32_t loaded = UINT32_MAX;  // 当前缓冲区中的块位图块索引
+    uint32_t run_start = 0, run_len = 0;
+
+    for (uint32_t i = 0; i < super_block.data_blocks; i++) {
+        if (i / bits_per_block != loaded) {
+            loaded = i / bits_per_block;
+            buffer = get_bitmap_block(super_block.block_bitmap + loaded);
+            if (buffer == nullptr) return -1;
+        }
+        uint32_t bit_in_block = i % bits_per_block;
+        if (buffer[bit_in_block / 8] & (1 << (bit_in_block % 8))) {
+            run_len = 0;  // 遇到已用块，重新计数
+            continue;
+        }
+        if (run_len == 0) run_start = i;
+        if (++run_len == count) {
+            return super_block.data_start + run_start;
+        }
+    }
     return -1;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 查找第一个空闲的inode（从inode位图中寻找未使用的inode）
+ * @return 找到的空闲inode编号；无空闲inode且无法扩展inode表或IO失败返回-1
+ * 依次遍历固定inode位图和各块组的位图；全部用尽时从数据区分配新的块组
+ */
+int DiskFS::find_free_inode() {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    // 在一个位图块中查找第一个空闲位（base为该位图块第0位对应的inode编号，count为有效位数）
+    auto scan_bitmap = [&](uint32_t bitmap_block, uint32_t base, uint32_t count) -> int {
+        char* buffer = get_bitmap_block(bitmap_block);
+        if (buffer == nullptr) return -1;  // 读取失败，跳过该位图块
+        for (uint32_t i = 0; i < count; i++) {
+            // 检查当前位是否为0（空闲inode）
+            if (!(buffer[i / 8] & (1 << (i % 8)))) {
+                return base + i;
+            }
+        }
+        return -1;
+    };
+
+    // 1. 固定inode区（位图可能跨多个块）
+    uint32_t bits_per_block = BLOCK_SIZE * 8;
+    for (uint32_t base = 0; base < (uint32_t)MAX_INODES; base += bits_per_block) {
+        uint32_t count = std::min(bits_per_block, (uint32_t)MAX_INODES - base);
+        int found = scan_bitmap(super_block.inode_bitmap + base / bits_per_block, base, count);
+        if (found != -1) return found;
+    }
+
+    // 2. 已分配的动态块组
+    for (uint32_t c = 0; c < super_block.inode_chunk_count; c++) {
+        int found = scan_bitmap(super_block.inode_chunks[c], MAX_INODES + c * INODE_CHUNK_INODES, INODE_CHUNK_INODES);
+        if (found != -1) return found;
+    }
+
+    // 3. 全部用尽：扩展inode表，新块组的第一个inode即为空闲inode
+    uint32_t first_new = super_block.total_inodes;
+    if (!grow_inode_table()) return -1;
+    return first_new;
+}
+
+
+/**
+ * @brief 获取缓存中的位图块（块位图或inode位图），未命中时从磁盘读入
+ * @param block_num 位图块的块号
+ * @return 指向缓存中块数据的指针（在卸载前一直有效）；读取失败返回nullptr
+ * 位图总量很小（100MB磁盘的块位图仅1块），挂载期间常驻内存；
+ * 修改后通过flush_bitmap_block立即写回
+ */
+char* DiskFS::get_bitmap_block(uint32_t block_num) {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    auto it = bitmap_cache.find(block_num);
+    if (it != bitmap_cache.end()) {
+        return it->second.data();
+    }
+
+    std::vector<char> data(BLOCK_SIZE);
+    if (!read_block(block_num, data.data())) {
+        return nullptr;
+    }
+    std::vector<char>& entry = bitmap_cache[block_num];
+    entry.swap(data);
+    return entry.data();
+}
+
+/**
+ * @brief 将缓存中的位图块写回磁盘
+ * @param block_num 位图块的块号（必须已在缓存中）
+ * @return 写入成功返回true；块不在缓存中或IO失败返回false
+ */
+bool DiskFS::flush_bitmap_block(uint32_t block_num) {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    auto it = bitmap_cache.find(block_num);
+    if (it == bitmap_cache.end()) return false;
+    return write_block(block_num, it->second.data());
+}
+
+/**
+ * @brief 将所有位图块读入缓存（挂载预加载时调用）
+ * @return 全部读取成功返回true；否则返回false
+ */
+bool DiskFS::load_bitmaps() {
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    uint32_t block_bitmap_size = ((MAX_BLOCKS + 7) / 8 + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t inode_bitmap_size = ((MAX_INODES + 7) / 8 + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    for (uint32_t i = 0; i < block_bitmap_size; i++) {
+        if (!get_bitmap_block(super_block.block_bitmap + i)) return false;
+    }
+    for (uint32_t i = 0; i < inode_bitmap_size; i++) {
+        if (!get_bitmap_block(super_block.inode_bitmap + i)) return false;
+    }
+    for (uint32_t c = 0; c < super_block.inode_chunk_count; c++) {
+        if (!get_bitmap_block(super_block.inode_chunks[c])) return false;
+    }
+    return true;
+}
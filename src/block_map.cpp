@@ -0,0 +1,218 @@
+#include "../include/disk_fs.h"
+#include <cstring>
+
+
+/**
+ * @brief 经指针块（间接块）查找或分配下一级块
+ * @param table 指针块的块号引用（为0且alloc为true时会分配新的指针块并回填）
+ * @param index 目标指针在指针块中的下标（0~PTRS_PER_BLOCK-1）
+ * @param alloc true表示目标指针为0时分配新块
+ * @param child_is_table true表示下一级块也是指针块（新分配时需清零）
+ * @param is_new 输出参数（可为nullptr）：目标块是否为本次新分配的块
+ * @return 下一级块的块号；未分配（alloc为false）或分配失败返回0
+ * 指针块通过元数据缓存访问，修改后立即写回
+ */
+uint32_t DiskFS::map_ptr(uint32_t& table, uint32_t index, bool alloc, bool child_is_table, bool* is_new)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    // 1. 确保指针块存在
+    if (table == 0) {
+        if (!alloc) return 0;
+        int new_table = alloc_block();
+        if (new_table == -1) return 0;
+        if (!get_meta_block(new_table, true) || !flush_meta_block(new_table)) return 0;
+        table = (uint32_t)new_table;
+    }
+
+    // 2. 读取目标指针
+    uint32_t* ptrs = (uint32_t*)get_meta_block(table);
+    if (ptrs == nullptr) return 0;
+    uint32_t child = ptrs[index];
+    if (child != 0 || !alloc) return child;
+
+    // 3. 目标指针为空：分配下一级块并回填指针
+    int new_child = alloc_block();
+    if (new_child == -1) return 0;
+    if (child_is_table) {
+        if (!get_meta_block(new_child, true) || !flush_meta_block(new_child)) return 0;
+    } else if (is_new) {
+        *is_new = true;
+    }
+
+    ptrs = (uint32_t*)get_meta_block(table);  // 重新获取（分配过程中缓存可能发生淘汰）
+    if (ptrs == nullptr) return 0;
+    ptrs[index] = (uint32_t)new_child;
+    flush_meta_block(table);
+    return (uint32_t)new_child;
+}
+
+/**
+ * @brief 将文件内的逻辑块号映射为磁盘块号
+ * @param inode 文件的inode（分配直接块或间接块时会被修改，调用者负责写回）
+ * @param block_idx 逻辑块号（文件偏移量 / BLOCK_SIZE）
+ * @param alloc true表示逻辑块未分配时分配新块
+ * @param is_new 输出参数（可为nullptr）：数据块是否为本次新分配的块（内容未初始化）
+ * @return 磁盘块号；未分配（alloc为false）、超出寻址范围或分配失败返回0
+ * 寻址范围：16个直接块 + 一级间接块1024个 + 二级间接块1024×1024个；
+ * 带INODE_FLAG_EXTENTS的inode改由extent树映射
+ */
+uint32_t DiskFS::bmap(Inode& inode, uint32_t block_idx, bool alloc, bool* is_new)
+{
+    // 内联文件与B+树目录没有按逻辑块号的映射
+    if (inode.flags & (INODE_FLAG_INLINE | INODE_FLAG_DIR_BTREE)) return 0;
+
+    // extent映射的文件交由extent树处理
+    if (inode.flags & INODE_FLAG_EXTENTS) {
+        return extent_map(inode, block_idx, alloc, is_new);
+    }
+
+    if (is_new) *is_new = false;
+
+    // 1. 直接块
+    if (block_idx < (uint32_t)DIRECT_BLOCKS) {
+        if (inode.blocks[block_idx] == 0 && alloc) {
+            int block_num = alloc_block();
+            if (block_num == -1) return 0;
+            inode.blocks[block_idx] = (uint32_t)block_num;
+            if (is_new) *is_new = true;
+        }
+        return inode.blocks[block_idx];
+    }
+    block_idx -= DIRECT_BLOCKS;
+
+    // 2. 一级间接块
+    if (block_idx < (uint32_t)PTRS_PER_BLOCK) {
+        return map_ptr(inode.indirect, block_idx, alloc, false, is_new);
+    }
+    block_idx -= PTRS_PER_BLOCK;
+
+    // 3. 二级间接块
+    if (block_idx < (uint32_t)PTRS_PER_BLOCK * PTRS_PER_BLOCK) {
+        uint32_t level1 = map_ptr(inode.double_indirect, block_idx / PTRS_PER_BLOCK, alloc, true, nullptr);
+        if (level1 == 0) return 0;
+        return map_ptr(level1, block_idx % PTRS_PER_BLOCK, alloc, false, is_new);
+    }
+
+    return 0;  // 超出最大寻址范围
+}
+
+/**
+ * @brief 解除一个逻辑块的映射，并释放对应的数据块
+ * @param inode 文件的inode（直接块指针可能被修改，调用者负责写回）
+ * @param block_idx 逻辑块号
+ * @return 成功解除返回true；该块未映射或无法解除返回false
+ * 间接块本身即使变空也保留，文件删除时统一释放
+ */
+bool DiskFS::unmap_block(Inode& inode, uint32_t block_idx)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    if (inode.flags & INODE_FLAG_INLINE) return false;
+    if (inode.flags & INODE_FLAG_EXTENTS) return extent_unmap(inode, block_idx);
+
+    // 1. 直接块
+    if (block_idx < (uint32_t)DIRECT_BLOCKS) {
+        if (inode.blocks[block_idx] == 0) return false;
+        set_block_bitmap(inode.blocks[block_idx], false);
+        inode.blocks[block_idx] = 0;
+        return true;
+    }
+    block_idx -= DIRECT_BLOCKS;
+
+    // 2. 定位存放该块指针的指针块
+    uint32_t table;
+    if (block_idx < (uint32_t)PTRS_PER_BLOCK) {
+        table = inode.indirect;
+    } else {
+        block_idx -= PTRS_PER_BLOCK;
+        if (block_idx >= (uint32_t)PTRS_PER_BLOCK * PTRS_PER_BLOCK) return false;
+        table = map_ptr(inode.double_indirect, block_idx / PTRS_PER_BLOCK, false, true, nullptr);
+        block_idx %= PTRS_PER_BLOCK;
+    }
+    if (table == 0) return false;
+
+    // 3. 清空指针并释放数据块
+    uint32_t* ptrs = (uint32_t*)get_meta_block(table);
+    if (ptrs == nullptr || ptrs[block_idx] == 0) return false;
+    uint32_t block_num = ptrs[block_idx];
+    ptrs[block_idx] = 0;
+    flush_meta_block(table);
+    set_block_bitmap(block_num, false);
+    return true;
+}
+
+/**
+ * @brief 释放一个指针块及其指向的所有块
+ * @param table 指针块的块号
+ * @param depth 0表示指针指向数据块；1表示指针指向下一级指针块
+ */
+void DiskFS::free_ptr_table(uint32_t table, int depth)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    char* data = get_meta_block(table);
+    if (data != nullptr) {
+        // 先复制指针（递归释放过程中缓存可能淘汰该块）
+        std::vector<uint32_t> children((uint32_t*)data, (uint32_t*)data + PTRS_PER_BLOCK);
+        for (uint32_t child : children) {
+            if (child == 0) continue;
+            if (depth > 0) {
+                free_ptr_table(child, depth - 1);
+            } else {
+                set_block_bitmap(child, false);
+            }
+        }
+    }
+    drop_meta_block(table);
+    set_block_bitmap(table, false);
+}
+
+/**
+ * @brief 释放文件占用的所有数据块与间接块（含共享尾部片段），并清空inode中的块指针
+ * @param inode 文件的inode（调用者负责写回）
+ */
+void DiskFS::free_file_blocks(Inode& inode)
+{
+    // 共享尾部块中的片段
+    if (inode.flags & INODE_FLAG_TAIL) {
+        release_tail(inode);
+    }
+
+    // 内联文件不占用数据块，清空内联区即可
+    if (inode.flags & INODE_FLAG_INLINE) {
+        memset(inode.blocks, 0, INLINE_DATA_SIZE);
+        inode.flags &= ~INODE_FLAG_INLINE;
+        return;
+    }
+
+    if (inode.flags & INODE_FLAG_EXTENTS) {
+        extent_free(inode);
+        return;
+    }
+
+    // B+树目录：blocks[0]为树根
+    if (inode.flags & INODE_FLAG_DIR_BTREE) {
+        if (inode.blocks[0] != 0) dtree_free(inode.blocks[0]);
+        inode.blocks[0] = 0;
+        inode.flags &= ~INODE_FLAG_DIR_BTREE;
+        return;
+    }
+
+    // 1. 直接块
+    for (int i = 0; i < DIRECT_BLOCKS; i++) {
+        if (inode.blocks[i] != 0) {
+            set_block_bitmap(inode.blocks[i], false);
+            inode.blocks[i] = 0;
+        }
+    }
+
+    // 2. 一级间接块
+    if (inode.indirect != 0) {
+        free_ptr_table(inode.indirect, 0);
+        inode.indirect = 0;
+    }
+
+    // 3. 二级间接块
+    if (inode.double_indirect != 0) {
+        free_ptr_table(inode.double_indirect, 1);
+        inode.double_indirect = 0;
+    }
+}
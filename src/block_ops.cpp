@@ -1,5 +1,6 @@
 #include "../include/disk_fs.h"
 #include <iostream>
+#include <cstring>
 
 
 
@@ -8,6 +9,7 @@
  */
 bool DiskFS::write_super_block() 
 {
+    std::lock_guard<std::mutex> io_lock(io_mutex);
     disk_file.seekp(0); // 超级块固定在磁盘0号位置
     disk_file.write((char*)&super_block, sizeof(SuperBlock));
     return disk_file.good(); // 检查写入是否成功
@@ -27,6 +29,7 @@ bool DiskFS::read_block(uint32_t block_num, char* buffer) {
     
     // 计算块在磁盘文件中的起始字节位置（块编号 × 块大小）
     uint32_t pos = block_num * BLOCK_SIZE;
+    std::lock_guard<std::mutex> io_lock(io_mutex);
     disk_file.seekg(pos);  // 将文件读指针定位到目标块的起始位置
     disk_file.read(buffer, BLOCK_SIZE);  // 读取整个块的数据到缓冲区
     return disk_file.good();  // 返回IO操作状态（true表示成功）
@@ -44,8 +47,104 @@ bool DiskFS::write_block(uint32_t block_num, const char* buffer) {
     
     // 计算块在磁盘文件中的起始字节位置
     uint32_t pos = block_num * BLOCK_SIZE;
+    std::lock_guard<std::mutex> io_lock(io_mutex);
     disk_file.seekp(pos);  // 将文件写指针定位到目标块的起始位置
     disk_file.write(buffer, BLOCK_SIZE);  // 将缓冲区数据写入整个块
     return disk_file.good();  // 返回IO操作状态
 }
 
+
+
+/**
+ * @brief 获取缓存中的元数据块（间接块等），未命中时从磁盘读入
+ * @param block_num 目标块的编号
+ * @param zero_fill true表示该块为新分配的块，直接以全0内容放入缓存（不读磁盘）
+ * @return 指向缓存中块数据（BLOCK_SIZE字节）的指针；读取失败返回nullptr
+ * 缓存按LRU淘汰，所有修改都通过flush_meta_block立即写回（写穿透），淘汰时无需回写；
+ * 返回的指针在下一次调用get_meta_block之前有效；多线程访问时，调用者须在使用指针期间持有meta_mutex
+ */
+char* DiskFS::get_meta_block(uint32_t block_num, bool zero_fill)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    auto it = meta_cache.find(block_num);
+    if (it != meta_cache.end()) {
+        // 命中：移动到LRU表头
+        meta_lru.splice(meta_lru.begin(), meta_lru, it->second.second);
+        if (zero_fill) memset(it->second.first.data(), 0, BLOCK_SIZE);
+        return it->second.first.data();
+    }
+
+    // 未命中：缓存已满时淘汰最久未使用的块
+    if (meta_cache.size() >= (size_t)META_CACHE_BLOCKS) {
+        meta_cache.erase(meta_lru.back());
+        meta_lru.pop_back();
+    }
+
+    std::vector<char> data(BLOCK_SIZE, 0);
+    if (!zero_fill && !read_block(block_num, data.data())) {
+        return nullptr;
+    }
+    meta_lru.push_front(block_num);
+    auto& entry = meta_cache[block_num];
+    entry.first.swap(data);
+    entry.second = meta_lru.begin();
+    return entry.first.data();
+}
+
+/**
+ * @brief 将缓存中的元数据块写回磁盘
+ * @param block_num 目标块的编号（必须已在缓存中）
+ * @return 写入成功返回true；块不在缓存中或IO失败返回false
+ */
+bool DiskFS::flush_meta_block(uint32_t block_num)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    auto it = meta_cache.find(block_num);
+    if (it == meta_cache.end()) return false;
+    return write_block(block_num, it->second.first.data());
+}
+
+/**
+ * @brief 从缓存中移除元数据块（块被释放后调用，避免残留过期内容）
+ * @param block_num 目标块的编号
+ */
+void DiskFS::drop_meta_block(uint32_t block_num)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    auto it = meta_cache.find(block_num);
+    if (it == meta_cache.end()) return;
+    meta_lru.erase(it->second.second);
+    meta_cache.erase(it);
+}
+
+/**
+ * @brief 从磁盘读取一段字节（不足一块的部分读取，用于共享尾部块等）
+ * @param pos 起始字节位置
+ * @param buffer 接收数据的缓冲区
+ * @param len 读取的字节数
+ * @return 读取成功返回true；IO失败返回false
+ */
+bool DiskFS::read_bytes(uint32_t pos, char* buffer, size_t len)
+{
+    std::lock_guard<std::mutex> io_lock(io_mutex);
+    disk_file.clear();
+    disk_file.seekg(pos);
+    disk_file.read(buffer, len);
+    return disk_file.good();
+}
+
+/**
+ * @brief 向磁盘写入一段字节（只改写指定范围，块内其余内容保持不变）
+ * @param pos 起始字节位置
+ * @param buffer 待写入的数据
+ * @param len 写入的字节数
+ * @return 写入成功返回true；IO失败返回false
+ */
+bool DiskFS::write_bytes(uint32_t pos, const char* buffer, size_t len)
+{
+    std::lock_guard<std::mutex> io_lock(io_mutex);
+    disk_file.clear();
+    disk_file.seekp(pos);
+    disk_file.write(buffer, len);
+    return disk_file.good();
+}
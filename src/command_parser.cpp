@@ -32,6 +32,10 @@ CommandType parse_command(const std::string& input, std::vector<std::string>& ar
         return CommandType::EXIT;
     } else if (token == "touch") {
         return CommandType::TOUCH;
+    } else if (token == "mkdir") {
+        return CommandType::MKDIR;
+    } else if (token == "rmdir") {
+        return CommandType::RMDIR;
     } else {
         return CommandType::UNKNOWN;
     }
@@ -0,0 +1,281 @@
+#include "../include/disk_fs.h"
+#include <cstring>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const uint8_t TAG_EMPTY = 0x80;    // 空槽（从未使用，查找到此即可停止）
+const uint8_t TAG_DELETED = 0xFE;  // 已删除槽（查找需越过，插入可复用）
+const int BLOOM_HASHES = 7;        // 布隆过滤器的哈希函数个数（每个目录项DIR_BLOOM_BITS位时误判率最低）
+
+/**
+ * @brief 逐个比较一组标签（无SIMD支持时的实现，也作为基准测试的对照）
+ * @param group 标签组首地址
+ * @param tag 目标标签
+ * @return 匹配位掩码
+ */
+uint32_t dir_tag_match_scalar(const uint8_t* group, uint8_t tag)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < DIR_INDEX_GROUP; i++) {
+        if (group[i] == tag) mask |= 1u << i;
+    }
+    return mask;
+}
+
+uint32_t dir_tag_match(const uint8_t* group, uint8_t tag)
+{
+#ifdef __SSE2__
+    __m128i tags = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8((char)tag)));
+#else
+    return dir_tag_match_scalar(group, tag);
+#endif
+}
+
+/**
+ * 有效槽的标签为哈希低7位（最高位为0），空槽与已删除槽的最高位为1，
+ * 因此各字节最高位组成的掩码即为空闲位置
+ */
+uint32_t dir_tag_free(const uint8_t* group)
+{
+#ifdef __SSE2__
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < DIR_INDEX_GROUP; i++) {
+        if (group[i] & 0x80) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * FNV-1a逐字节累积后再做一次64位混合（murmur3 fmix64），使低7位标签与高位分组都分布均匀
+ */
+size_t dir_name_hash(const char* name, size_t len)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return (size_t)hash;
+}
+
+/**
+ * @brief 查找文件名所在的槽位
+ * @param name 文件名首地址
+ * @param len 文件名长度
+ * @param hash 文件名的哈希值
+ * @return 槽位下标；不存在返回-1
+ * 从哈希值高位决定的组开始按三角数步长逐组探测（组数为2的幂，可遍历全部组）
+ */
+long DirIndex::probe(const char* name, size_t len, size_t hash) const
+{
+    if (tags.empty()) return -1;
+    size_t group_mask = tags.size() / DIR_INDEX_GROUP - 1;
+    size_t group = (hash >> 7) & group_mask;
+    uint8_t tag = (uint8_t)(hash & 0x7F);
+
+    for (size_t step = 1; step <= group_mask + 1; step++) {
+        const uint8_t* base = &tags[group * DIR_INDEX_GROUP];
+        for (uint32_t mask = dir_tag_match(base, tag); mask != 0; mask &= mask - 1) {
+            size_t i = group * DIR_INDEX_GROUP + __builtin_ctz(mask);
+            if (items[i].hash == hash && items[i].name.size() == len && memcmp(items[i].name.data(), name, len) == 0) return (long)i;
+        }
+        if (dir_tag_match(base, TAG_EMPTY) != 0) return -1;  // 组内有空槽：文件名不可能在后续组中
+        group = (group + step) & group_mask;
+    }
+    return -1;
+}
+
+/**
+ * @brief 查找文件名对应的目录项位置
+ * @param name 文件名首地址（可以是路径中的一个分量，不要求以'\0'结尾）
+ * @param len 文件名长度
+ * @return 指向目录项位置的指针（下一次insert/erase前有效）；不存在返回nullptr
+ */
+DirSlot* DirIndex::find(const char* name, size_t len)
+{
+    long i = probe(name, len, dir_name_hash(name, len));
+    return i < 0 ? nullptr : &items[i].slot;
+}
+
+/**
+ * @brief 登记文件名对应的目录项位置（已存在时覆盖）
+ * @param name 文件名
+ * @param slot 目录项位置
+ * 有效槽与已删除槽合计超过7/8时重建：已删除槽较多则按原大小重建，否则槽位数加倍
+ */
+void DirIndex::insert(const std::string& name, const DirSlot& slot)
+{
+    size_t hash = dir_name_hash(name.data(), name.size());
+    long found = probe(name.data(), name.size(), hash);
+    if (found >= 0) {
+        items[found].slot = slot;
+        return;
+    }
+
+    if ((count + deleted + 1) * 8 > tags.size() * 7) {
+        rehash(tags.empty() ? DIR_INDEX_GROUP : (count + 1) * 2 > tags.size() ? tags.size() * 2 : tags.size());
+    }
+
+    size_t group_mask = tags.size() / DIR_INDEX_GROUP - 1;
+    size_t group = (hash >> 7) & group_mask;
+    for (size_t step = 1; ; step++) {
+        uint32_t mask = dir_tag_free(&tags[group * DIR_INDEX_GROUP]);
+        if (mask != 0) {
+            size_t i = group * DIR_INDEX_GROUP + __builtin_ctz(mask);
+            if (tags[i] == TAG_DELETED) deleted--;
+            tags[i] = (uint8_t)(hash & 0x7F);
+            items[i].name = name;
+            items[i].slot = slot;
+            items[i].hash = hash;
+            count++;
+            return;
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+/**
+ * @brief 删除文件名对应的目录项位置
+ * @param name 文件名
+ * @return 删除成功返回true；不存在返回false
+ */
+bool DirIndex::erase(const std::string& name)
+{
+    long i = probe(name.data(), name.size(), dir_name_hash(name.data(), name.size()));
+    if (i < 0) return false;
+    tags[i] = TAG_DELETED;
+    std::string().swap(items[i].name);  // 释放文件名占用的内存
+    count--;
+    deleted++;
+    return true;
+}
+
+void DirIndex::clear()
+{
+    std::vector<uint8_t>().swap(tags);
+    std::vector<Item>().swap(items);
+    count = 0;
+    deleted = 0;
+}
+
+void DirIndex::swap(DirIndex& other)
+{
+    tags.swap(other.tags);
+    items.swap(other.items);
+    std::swap(count, other.count);
+    std::swap(deleted, other.deleted);
+}
+
+/**
+ * @brief 将全部有效目录项重新放入slots个槽位（按保存的完整哈希值定位，不重新计算）
+ * @param slots 新的槽位数（DIR_INDEX_GROUP的2的幂倍）
+ */
+void DirIndex::rehash(size_t slots)
+{
+    std::vector<uint8_t> old_tags(slots, TAG_EMPTY);
+    std::vector<Item> old_items(slots);
+    old_tags.swap(tags);
+    old_items.swap(items);
+    count = 0;
+    deleted = 0;
+
+    size_t group_mask = slots / DIR_INDEX_GROUP - 1;
+    for (size_t j = 0; j < old_tags.size(); j++) {
+        if (old_tags[j] & 0x80) continue;
+        size_t group = (old_items[j].hash >> 7) & group_mask;
+        for (size_t step = 1; ; step++) {
+            uint32_t mask = dir_tag_free(&tags[group * DIR_INDEX_GROUP]);
+            if (mask != 0) {
+                size_t i = group * DIR_INDEX_GROUP + __builtin_ctz(mask);
+                tags[i] = old_tags[j];
+                items[i].name.swap(old_items[j].name);
+                items[i].slot = old_items[j].slot;
+                items[i].hash = old_items[j].hash;
+                count++;
+                break;
+            }
+            group = (group + step) & group_mask;
+        }
+    }
+}
+
+/**
+ * @brief 按文件名哈希值列表重新建立布隆过滤器
+ * @param hashes 全部文件名的哈希值
+ * 容量取现有目录项数的两倍（至少DIR_BLOOM_MIN），使之后的插入不必立即重建
+ */
+void DirBloom::build(const std::vector<size_t>& hashes)
+{
+    capacity = std::max(hashes.size() * 2, (size_t)DIR_BLOOM_MIN);
+    bits.assign((capacity * DIR_BLOOM_BITS + 63) / 64, 0);
+    added = hashes.size();
+    removed = 0;
+    for (size_t hash : hashes) set_hash(hash);
+}
+
+/**
+ * 由一个64位哈希值派生BLOOM_HASHES个位置：第i个位置为 h1 + i*h2（h2取奇数，保证各位置互不相同）
+ */
+void DirBloom::set_hash(size_t hash)
+{
+    uint64_t nbits = bits.size() * 64;
+    uint64_t h1 = hash;
+    uint64_t h2 = ((uint64_t)hash >> 32 | (uint64_t)hash << 32) | 1;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) % nbits;
+        bits[bit / 64] |= 1ull << (bit % 64);
+    }
+}
+
+void DirBloom::add(const std::string& name)
+{
+    if (bits.empty()) return;
+    set_hash(dir_name_hash(name.data(), name.size()));
+    added++;
+}
+
+/**
+ * @brief 判断文件名是否可能在目录中
+ * @param name 文件名首地址
+ * @param len 文件名长度
+ * @return 返回false时文件名一定不存在；返回true时可能存在（需查询B+树）
+ */
+bool DirBloom::may_contain(const char* name, size_t len) const
+{
+    if (bits.empty()) return true;
+    uint64_t nbits = bits.size() * 64;
+    size_t hash = dir_name_hash(name, len);
+    uint64_t h1 = hash;
+    uint64_t h2 = ((uint64_t)hash >> 32 | (uint64_t)hash << 32) | 1;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) % nbits;
+        if (!(bits[bit / 64] & (1ull << (bit % 64)))) return false;
+    }
+    return true;
+}
+
+void DirBloom::clear()
+{
+    std::vector<uint64_t>().swap(bits);
+    capacity = 0;
+    added = 0;
+    removed = 0;
+}
+
+void DirBloom::swap(DirBloom& other)
+{
+    bits.swap(other.bits);
+    std::swap(capacity, other.capacity);
+    std::swap(added, other.added);
+    std::swap(removed, other.removed);
+}
@@ -0,0 +1,878 @@
+#include "../include/disk_fs.h"
+#include <cstring>
+#include <iostream>
+#include <ctime>
+#include <functional>
+
+/**
+ * @brief 旧版定长目录项（36字节，仅用于转换无INODE_FLAG_DIR_VARLEN标志的旧目录）
+ */
+struct LegacyDirEntry
+{
+    char name[28];           // 文件名（含'\0'）
+    uint32_t inode_num;      // 对应的inode编号
+    uint8_t valid;           // 1表示有效
+    uint8_t type;            // 文件类型
+};
+
+static_assert(sizeof(LegacyDirEntry) == 36, "旧版目录项为36字节");
+static const int LEGACY_DIRENTS_PER_BLOCK = BLOCK_SIZE / sizeof(LegacyDirEntry);
+
+/**
+ * @brief 计算目录记录的最小长度（记录头 + 文件名，4字节对齐）
+ */
+static uint32_t record_size(uint32_t name_len)
+{
+    return (sizeof(DirRecord) + name_len + 3) & ~3u;
+}
+
+/**
+ * @brief 判断块内偏移处的记录是否完整落在块内（防止损坏的rec_len导致越界或死循环）
+ */
+static bool record_ok(const char* data, uint32_t offset)
+{
+    if (offset + sizeof(DirRecord) > (uint32_t)BLOCK_SIZE) return false;
+    const DirRecord* record = (const DirRecord*)(data + offset);
+    return record->rec_len >= sizeof(DirRecord) && offset + record->rec_len <= (uint32_t)BLOCK_SIZE &&
+           record->rec_len >= (record->name_len ? record_size(record->name_len) : sizeof(DirRecord));
+}
+
+/**
+ * @brief 记录中可放入新记录的空间（空闲记录为整条记录，有效记录为其后未使用的部分）
+ */
+static uint32_t record_gap(const DirRecord* record)
+{
+    return record->name_len == 0 ? record->rec_len : record->rec_len - record_size(record->name_len);
+}
+
+/**
+ * @brief 计算目录块内最大的一段可用空间
+ */
+static uint16_t block_max_free(const char* data)
+{
+    uint32_t max_free = 0;
+    for (uint32_t offset = 0; record_ok(data, offset); offset += ((const DirRecord*)(data + offset))->rec_len) {
+        uint32_t gap = record_gap((const DirRecord*)(data + offset));
+        if (gap > max_free) max_free = gap;
+    }
+    return (uint16_t)max_free;
+}
+
+/**
+ * @brief 初始化只含一条记录的目录块（"."或空闲记录）
+ */
+static void init_dir_block(char* data, uint32_t inode_num, const char* name, uint8_t type)
+{
+    memset(data, 0, BLOCK_SIZE);
+    DirRecord* record = (DirRecord*)data;
+    record->inode_num = inode_num;
+    record->rec_len = BLOCK_SIZE;
+    record->name_len = (uint8_t)strlen(name);
+    record->type = type;
+    memcpy(record + 1, name, record->name_len);
+}
+
+/**
+ * @brief 获取目录的内存状态，未加载时扫描目录建立
+ * @param dir 目录的inode编号
+ * @return 指向目录状态的指针（在该目录被删除或卸载前一直有效）；不是目录或IO失败返回nullptr
+ */
+DirState* DiskFS::get_dir(uint32_t dir)
+{
+    std::lock_guard<std::mutex> states_lock(dir_states_mutex);  // 加载期间一直持有，同一目录只加载一次
+    auto it = dir_states.find(dir);
+    if (it != dir_states.end()) return &it->second;
+
+    DirState state;
+    if (!load_dir(dir, state)) return nullptr;
+    DirState& entry = dir_states[dir];
+    entry.index.swap(state.index);
+    entry.blocks.swap(state.blocks);
+    entry.free_blocks.swap(state.free_blocks);
+    entry.names.swap(state.names);
+    entry.tree_root = state.tree_root;
+    entry.bloom.swap(state.bloom);
+    entry.version = ++dir_versions;
+    return &entry;
+}
+
+/**
+ * @brief 扫描目录的所有目录块，建立内存中的哈希目录索引
+ * @param dir 目录的inode编号
+ * @param state 接收目录状态
+ * @return 建立成功返回true；inode不是目录或IO失败返回false
+ * 索引只保存在内存中：目录块仍是唯一的持久化来源，每次挂载后重新扫描；
+ * 同时记录各目录块的磁盘块号与最大可用空间，以及仍有可用空间的块，供插入时直接定位。
+ * B+树目录本身即为磁盘上的索引，只记录树根，并扫描叶子建立文件名布隆过滤器。定长目录项格式的旧目录先转换为变长记录格式
+ */
+bool DiskFS::load_dir(uint32_t dir, DirState& state)
+{
+    Inode dir_inode;
+    if (!read_inode(dir, dir_inode) || !dir_inode.used || dir_inode.type != 2) return false;  // 必须是目录类型
+    if (!(dir_inode.flags & INODE_FLAG_DIR_VARLEN) && !dir_upgrade(dir, dir_inode)) {
+        std::cerr << "目录 " << dir << " 转换为变长目录项格式失败" << std::endl;
+        return false;
+    }
+    if (dir_inode.flags & INODE_FLAG_DIR_BTREE) {
+        state.tree_root = dir_inode.blocks[0];
+        if (state.tree_root == 0) return false;
+        dir_build_bloom(state);
+        return true;
+    }
+
+    char buffer[BLOCK_SIZE];
+    uint32_t block_count = (dir_inode.size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (uint32_t b = 0; b < block_count; b++) {
+        uint32_t block_num = bmap(dir_inode, b, false);
+        if (block_num == 0 || !read_block(block_num, buffer)) return false;
+
+        // 0号块偏移0处的记录为"."，不登记
+        for (uint32_t offset = 0; record_ok(buffer, offset); offset += ((DirRecord*)(buffer + offset))->rec_len) {
+            const DirRecord* record = (const DirRecord*)(buffer + offset);
+            if (record->name_len == 0 || (b == 0 && offset == 0)) continue;
+            std::string name((const char*)(record + 1), record->name_len);
+            DirSlot slot;
+            slot.inode_num = record->inode_num;
+            slot.block = b;
+            slot.slot = offset;
+            slot.type = record->type;
+            state.index.insert(name, slot);
+            state.names.insert(name);
+        }
+
+        DirBlockInfo info;
+        info.block = block_num;
+        info.max_free = block_max_free(buffer);
+        if (info.max_free >= record_size(1)) state.free_blocks.insert(b);
+        state.blocks.push_back(info);
+    }
+    return true;
+}
+
+/**
+ * @brief 将定长目录项格式的旧目录转换为变长记录格式
+ * @param dir 目录的inode编号
+ * @param dir_inode 目录inode（转换成功后更新标志并写回）
+ * @return 转换成功返回true；空间不足或IO失败返回false
+ * 逐块原地转换：每块的有效目录项按原顺序紧密排列（36字节的定长项转换后不会变长，必然放得下）。
+ * 旧格式中没有B+树目录（B+树目录创建时即为变长记录格式）
+ */
+bool DiskFS::dir_upgrade(uint32_t dir, Inode& dir_inode)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    char buffer[BLOCK_SIZE];
+    const LegacyDirEntry* old_entries = (const LegacyDirEntry*)buffer;
+    uint32_t block_count = (dir_inode.size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (uint32_t b = 0; b < block_count; b++) {
+        uint32_t block_num = bmap(dir_inode, b, false);
+        if (block_num == 0 || !read_block(block_num, buffer)) return false;
+
+        char* data = get_meta_block(block_num, true);
+        if (data == nullptr) return false;
+        init_dir_block(data, 0, "", 0);  // 先写入覆盖整块的空闲记录
+        DirRecord* last = nullptr;
+        uint32_t offset = 0;
+        for (int i = 0; i < LEGACY_DIRENTS_PER_BLOCK; i++) {
+            if (!old_entries[i].valid) continue;
+            uint32_t name_len = strnlen(old_entries[i].name, sizeof(old_entries[i].name) - 1);
+            DirRecord* record = (DirRecord*)(data + offset);
+            record->inode_num = old_entries[i].inode_num;
+            record->rec_len = (uint16_t)record_size(name_len);
+            record->name_len = (uint8_t)name_len;
+            record->type = old_entries[i].type;
+            memcpy(record + 1, old_entries[i].name, name_len);
+            offset += record->rec_len;
+            last = record;
+        }
+        if (last != nullptr) last->rec_len += (uint16_t)(BLOCK_SIZE - offset);  // 最后一条记录延伸到块尾
+        if (!flush_meta_block(block_num)) return false;
+    }
+    dir_inode.flags |= INODE_FLAG_DIR_VARLEN;
+    return write_inode(dir, dir_inode);
+}
+
+/**
+ * @brief 在目录中按文件名查找inode编号
+ * @param dir 目录的inode编号
+ * @param name 目标文件名首地址（不要求以'\0'结尾）
+ * @param len 文件名长度
+ * @param type 输出参数（可为nullptr）：目录项记录的文件类型
+ * @return 找到返回inode编号；不存在返回-1
+ * 线性目录直接查询哈希索引（按组比较标签，见DirIndex），为O(1)且不分配内存，不读取目录块；
+ * B+树目录先查布隆过滤器，判定一定不存在时直接返回；否则自树根向下查找，读取的块数不超过树高
+ */
+int DiskFS::dir_lookup(uint32_t dir, const char* name, size_t len, uint8_t* type)
+{
+    DirState* state = get_dir(dir);
+    if (state == nullptr) return -1;
+    if (state->tree_root != 0) {
+        if (!state->bloom.may_contain(name, len)) return -1;  // 一定不存在：不访问树块
+        return dtree_lookup(state->tree_root, std::string(name, len), type);
+    }
+
+    const DirSlot* slot = state->index.find(name, len);
+    if (slot == nullptr) return -1;
+    if (type) *type = slot->type;
+    return (int)slot->inode_num;
+}
+
+/**
+ * @brief 按B+树中现有的文件名重建目录的布隆过滤器
+ * @param state 目录状态（须为B+树目录）
+ * 遍历全部叶子，读取的块数与目录大小成正比，只在首次加载目录及过滤器容量用尽时进行；
+ * 读取失败时清空过滤器（视为可能包含任何文件名），查找仍正确，只是不再跳过树块
+ */
+void DiskFS::dir_build_bloom(DirState& state)
+{
+    std::vector<size_t> hashes;
+    if (dtree_hash_names(state.tree_root, hashes)) {
+        state.bloom.build(hashes);
+    } else {
+        state.bloom.clear();
+    }
+}
+
+/**
+ * @brief 为线性目录追加一个目录块（所有目录块均已满时调用）
+ * @param dir 目录的inode编号
+ * @param state 目录状态
+ * @return 新目录块的序号（逻辑块号）；磁盘空间不足或IO失败返回-1
+ */
+int DiskFS::dir_grow(uint32_t dir, DirState& state)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    Inode dir_inode;
+    if (!read_inode(dir, dir_inode) || dir_inode.type != 2) return -1;
+
+    uint32_t index = (uint32_t)state.blocks.size();
+    uint32_t block_num = bmap(dir_inode, index, true);
+    if (block_num == 0) return -1;
+
+    // 新目录块只含一条覆盖整块的空闲记录（经元数据缓存写入），再更新目录大小
+    char* data = get_meta_block(block_num, true);
+    if (data == nullptr) return -1;
+    init_dir_block(data, 0, "", 0);
+    if (!flush_meta_block(block_num)) return -1;
+    dir_inode.size = (index + 1) * BLOCK_SIZE;
+    if (!write_inode(dir, dir_inode)) return -1;
+
+    DirBlockInfo info;
+    info.block = block_num;
+    info.max_free = BLOCK_SIZE;
+    state.blocks.push_back(info);
+    state.free_blocks.insert(index);
+    return (int)index;
+}
+
+/**
+ * @brief 将线性目录转换为B+树目录（线性目录已占满DIR_BTREE_MIN_BLOCKS个块时调用）
+ * @param dir 目录的inode编号
+ * @param state 目录状态
+ * @return 转换成功返回true；空间不足或IO失败返回false（此时目录保持线性格式不变）
+ * 先由内存索引中的全部目录项建好B+树，再释放原线性目录块并更新目录inode；
+ * 线性目录中的"."不迁移（B+树目录不保存"."）
+ */
+bool DiskFS::dir_convert_to_tree(uint32_t dir, DirState& state)
+{
+    Inode dir_inode;
+    if (!read_inode(dir, dir_inode) || dir_inode.type != 2) return false;
+
+    // 1. 建立B+树并插入全部目录项
+    uint32_t tree_root = dtree_create();
+    if (tree_root == 0) return false;
+    bool inserted = true;
+    std::vector<size_t> hashes;
+    state.index.for_each([&](const std::string& name, const DirSlot& slot) {
+        if (inserted) inserted = dtree_insert(tree_root, name, slot.inode_num, slot.type);
+        hashes.push_back(dir_name_hash(name.data(), name.size()));
+    });
+    if (!inserted) {
+        dtree_free(tree_root);
+        return false;
+    }
+
+    // 2. 释放线性目录块，目录改为B+树格式
+    free_file_blocks(dir_inode);
+    dir_inode.flags |= INODE_FLAG_DIR_BTREE;
+    dir_inode.blocks[0] = tree_root;
+    dir_inode.size = BLOCK_SIZE;  // B+树目录的大小不随目录项数变化
+    if (!write_inode(dir, dir_inode)) return false;
+
+    state.index.clear();
+    state.blocks.clear();
+    state.free_blocks.clear();
+    state.names.clear();
+    state.tree_root = tree_root;
+    state.bloom.build(hashes);
+    return true;
+}
+
+/**
+ * @brief 在目录中添加目录项并登记到索引
+ * @param dir 目录的inode编号
+ * @param name 文件名（调用者已检查长度与重名）
+ * @param inode_num 文件的inode编号
+ * @param type 文件类型（1：普通文件，2：目录）
+ * @return 添加成功返回true；目录无法扩展或IO失败返回false
+ * 线性目录按内存中记录的各块最大可用空间选择序号最小的放得下新记录的块，只读写该块：
+ * 在块内找到空闲记录或有效记录之后未使用的空间，拆分出新记录；全部块都放不下时追加新块，
+ * 已达DIR_BTREE_MIN_BLOCKS块时改为转换成B+树目录
+ */
+bool DiskFS::dir_add(uint32_t dir, const std::string& name, uint32_t inode_num, uint8_t type)
+{
+    DirState* state = get_dir(dir);
+    if (state == nullptr) return false;
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+
+    // 1. 选择序号最小的放得下新记录的目录块，没有则扩展目录
+    uint32_t need = record_size(name.size());
+    int target = -1;
+    for (uint32_t b : state->free_blocks) {
+        if (state->blocks[b].max_free >= need) {
+            target = (int)b;
+            break;
+        }
+    }
+    if (target == -1 && state->tree_root == 0 && state->blocks.size() >= (size_t)DIR_BTREE_MIN_BLOCKS) {
+        if (!dir_convert_to_tree(dir, *state)) {
+            std::cerr << "创建文件失败：目录转换为B+树目录失败" << std::endl;
+            return false;
+        }
+    }
+    if (state->tree_root != 0) {
+        if (!dtree_insert(state->tree_root, name, inode_num, type)) {
+            std::cerr << "创建文件失败：B+树目录插入失败" << std::endl;
+            return false;
+        }
+        state->bloom.add(name);
+        if (state->bloom.stale()) dir_build_bloom(*state);
+        state->version = ++dir_versions;
+        dentry_set(dir, name, (int)inode_num, type);
+        return true;
+    }
+    if (target == -1) {
+        target = dir_grow(dir, *state);
+        if (target == -1) {
+            std::cerr << "创建文件失败：目录无法扩展（磁盘空间不足）" << std::endl;
+            return false;
+        }
+    }
+    DirBlockInfo& info = state->blocks[target];
+
+    // 2. 经元数据缓存获取目标目录块，找到足够大的空闲空间
+    char* data = get_meta_block(info.block);
+    if (data == nullptr) {
+        std::cerr << "创建文件失败：读取目录数据块失败" << std::endl;
+        return false;
+    }
+    uint32_t offset = 0;
+    while (record_ok(data, offset) && record_gap((DirRecord*)(data + offset)) < need) {
+        offset += ((DirRecord*)(data + offset))->rec_len;
+    }
+    if (!record_ok(data, offset)) return false;  // 内存中的可用空间与磁盘内容不一致
+
+    // 3. 拆分出新记录：空闲记录直接复用，有效记录则从其未使用的部分切出
+    DirRecord* record = (DirRecord*)(data + offset);
+    if (record->name_len != 0) {
+        uint32_t used = record_size(record->name_len);
+        uint16_t rest = (uint16_t)(record->rec_len - used);
+        record->rec_len = (uint16_t)used;
+        offset += used;
+        record = (DirRecord*)(data + offset);
+        record->rec_len = rest;
+    }
+    record->inode_num = inode_num;
+    record->name_len = (uint8_t)name.size();
+    record->type = type;
+    memcpy(record + 1, name.data(), name.size());
+
+    // 4. 写回目录块，成功后再登记索引
+    if (!flush_meta_block(info.block)) {
+        std::cerr << "创建文件失败：写回目录数据块失败" << std::endl;
+        return false;
+    }
+    info.max_free = block_max_free(data);
+    if (info.max_free < record_size(1)) state->free_blocks.erase((uint32_t)target);
+    state->version = ++dir_versions;
+
+    DirSlot slot;
+    slot.inode_num = inode_num;
+    slot.block = (uint32_t)target;
+    slot.slot = offset;
+    slot.type = type;
+    state->index.insert(name, slot);
+    state->names.insert(name);
+    dentry_set(dir, name, (int)inode_num, type);
+    return true;
+}
+
+/**
+ * @brief 从目录中移除目录项并从索引中删除
+ * @param dir 目录的inode编号
+ * @param name 目标文件名
+ * @return 移除成功返回true；不存在或IO失败返回false
+ * 线性目录由索引直接定位目录记录所在的块和偏移，只读写该目录块：记录并入前一条记录
+ * （块首的记录则标记为空闲记录）；B+树目录只修改所在叶子
+ */
+bool DiskFS::dir_remove(uint32_t dir, const std::string& name)
+{
+    DirState* state = get_dir(dir);
+    if (state == nullptr) return false;
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+
+    if (state->tree_root != 0) {
+        if (!dtree_remove(state->tree_root, name)) return false;
+        state->bloom.remove();
+        if (state->bloom.stale()) dir_build_bloom(*state);
+        state->version = ++dir_versions;
+        dentry_set(dir, name, -1);
+        return true;
+    }
+
+    const DirSlot* slot = state->index.find(name);
+    if (slot == nullptr) return false;
+    DirBlockInfo& info = state->blocks[slot->block];
+
+    char* data = get_meta_block(info.block);
+    if (data == nullptr) return false;
+    uint32_t prev = UINT32_MAX;
+    uint32_t offset = 0;
+    while (offset != slot->slot && record_ok(data, offset)) {
+        prev = offset;
+        offset += ((DirRecord*)(data + offset))->rec_len;
+    }
+    if (offset != slot->slot) return false;
+    DirRecord* record = (DirRecord*)(data + offset);
+    if (prev != UINT32_MAX) {
+        ((DirRecord*)(data + prev))->rec_len += record->rec_len;
+    } else {
+        record->name_len = 0;
+        record->inode_num = 0;
+        record->type = 0;
+    }
+    if (!flush_meta_block(info.block)) return false;
+    info.max_free = block_max_free(data);
+    state->free_blocks.insert(slot->block);
+    state->version = ++dir_versions;
+
+    state->index.erase(name);
+    state->names.erase(name);
+    dentry_set(dir, name, -1);  // 保留为否定条目：删除后的文件名常被再次探测
+    return true;
+}
+
+/**
+ * @brief 判断目录是否为空（不含"."以外的目录项）
+ * @param dir 目录的inode编号
+ * @return 为空返回true；非空、不是目录或IO失败返回false
+ */
+bool DiskFS::dir_is_empty(uint32_t dir)
+{
+    DirState* state = get_dir(dir);
+    if (state == nullptr) return false;
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    if (state->tree_root == 0) return state->index.empty();
+
+    // B+树目录删除时不合并节点，需沿叶子链表确认所有叶子均为空
+    uint32_t leaf = dtree_first_leaf(state->tree_root);
+    while (leaf != 0) {
+        char* data = get_meta_block(leaf);
+        if (data == nullptr) return false;
+        DirTreeHeader* header = (DirTreeHeader*)data;
+        if (header->entries > 0) return false;
+        leaf = header->next;
+    }
+    return true;
+}
+
+/**
+ * @brief 解析路径，返回最后一个分量的父目录
+ * @param path 路径（如"a/b/c"或"/a/b/c"）
+ * @param leaf 输出参数：最后一个分量（文件名）；路径为根目录时为空串
+ * @return 父目录的inode编号；中间分量不存在或不是目录时返回-1
+ * 供需要保存文件名的调用者（创建、删除）使用，解析本身见下面的原地版本
+ */
+int DiskFS::resolve_parent(const std::string& path, std::string& leaf)
+{
+    const char* name = path.data();
+    size_t name_len = 0, entered = 0;
+    int parent = resolve_parent(path.data(), path.size(), name, name_len, entered);
+    leaf.assign(name, name_len);
+    return parent;
+}
+
+/**
+ * @brief 原地解析路径前缀，返回最后一个分量的父目录
+ * @param path 路径首地址
+ * @param len 解析的前缀长度
+ * @param leaf 输出参数：最后一个分量在path中的首地址
+ * @param leaf_len 输出参数：最后一个分量的长度；路径为根目录时为0
+ * @param entered 输出参数：进入返回的目录时所经分量在path中的偏移（返回根目录时无意义）
+ * @return 父目录的inode编号；中间分量不存在或不是目录时返回-1
+ * 分量以(指针, 长度)表示，经目录项缓存查找（命中时不访问目录，也不分配内存），
+ * 所经过目录的状态（索引、目录块表）在首次访问后常驻内存；"."忽略；
+ * ".."回到上一级：重新解析进入当前目录之前的路径前缀（各分量仍命中目录项缓存），根目录的上一级仍为根目录
+ */
+int DiskFS::resolve_parent(const char* path, size_t len, const char*& leaf, size_t& leaf_len, size_t& entered)
+{
+    uint32_t dir = 0;
+    leaf_len = 0;
+    entered = 0;
+
+    size_t pos = 0;
+    while (pos < len) {
+        const char* slash = (const char*)memchr(path + pos, '/', len - pos);
+        size_t end = slash != nullptr ? (size_t)(slash - path) : len;
+        const char* component = path + pos;
+        size_t component_len = end - pos;
+        pos = end + 1;
+        if (component_len == 0 || (component_len == 1 && component[0] == '.')) continue;
+
+        // 上一个分量确认为目录后再进入
+        if (leaf_len > 0) {
+            uint8_t type = 0;
+            int inode_num = dentry_lookup(dir, leaf, leaf_len, &type);
+            if (inode_num == -1 || type != 2) return -1;
+            dir = (uint32_t)inode_num;
+            entered = (size_t)(leaf - path);
+            leaf_len = 0;
+        }
+        if (component_len == 2 && component[0] == '.' && component[1] == '.') {
+            if (dir != 0) {
+                const char* up = path;
+                size_t up_len = 0;
+                int parent = resolve_parent(path, entered, up, up_len, entered);
+                if (parent != -1 && up_len > 0) {
+                    entered = (size_t)(up - path);
+                    parent = dentry_lookup((uint32_t)parent, up, up_len);
+                }
+                if (parent == -1) return -1;
+                dir = (uint32_t)parent;
+            }
+            continue;
+        }
+        leaf = component;
+        leaf_len = component_len;
+    }
+    return (int)dir;
+}
+
+/**
+ * @brief 解析路径，返回目标的inode编号
+ * @param path 路径（空串或"/"表示根目录）
+ * @return 目标inode编号；不存在返回-1
+ */
+int DiskFS::resolve_path(const std::string& path)
+{
+    const char* leaf = path.data();
+    size_t leaf_len = 0, entered = 0;
+    int parent = resolve_parent(path.data(), path.size(), leaf, leaf_len, entered);
+    if (parent == -1) return -1;
+    if (leaf_len == 0) return parent;
+    return dentry_lookup((uint32_t)parent, leaf, leaf_len);
+}
+
+/**
+ * @brief 创建目录：分配inode与一个目录块，并在父目录中添加目录项
+ * @param path 新目录的路径（父目录必须已存在）
+ * @return 成功返回新目录的inode编号；失败返回-1（已存在/父目录不存在/无空闲inode或块等）
+ * 新目录的布局与根目录相同：0号块的0号目录项为"."
+ */
+int DiskFS::create_dir(const std::string& path)
+{
+    std::lock_guard<SharedMutex> ns_lock(namespace_mutex);
+    std::string name;
+    int parent = isMounted() ? resolve_parent(path, name) : -1;
+    if (parent == -1 || name.empty() || name.length() >= MAX_FILENAME) {
+        std::cerr << "创建目录失败：磁盘未挂载、父目录不存在或目录名无效" << std::endl;
+        return -1;
+    }
+    if (dentry_lookup((uint32_t)parent, name) != -1) {
+        std::cerr << "创建目录失败：" << path << " 已存在" << std::endl;
+        return -1;
+    }
+
+    // 1. 分配inode与目录块（查找空闲inode至标记位图期间持有分配器锁，避免两个线程取得同一inode）
+    std::unique_lock<std::recursive_mutex> meta_lock(meta_mutex);
+    std::unique_lock<std::recursive_mutex> alloc_lock(alloc_mutex);
+    int inode_num = find_free_inode();
+    if (inode_num == -1) {
+        std::cerr << "创建目录失败：无空闲inode" << std::endl;
+        return -1;
+    }
+    int block_num = alloc_block();
+    if (block_num == -1) {
+        std::cerr << "创建目录失败：无空闲数据块" << std::endl;
+        return -1;
+    }
+
+    // 2. 初始化目录块（只含"."，经元数据缓存写入）并写入目录inode
+    char* data = get_meta_block(block_num, true);
+    if (data == nullptr) {
+        set_block_bitmap(block_num, false);
+        return -1;
+    }
+    init_dir_block(data, (uint32_t)inode_num, ".", 2);
+
+    time_t now = time(nullptr);
+    Inode dir_inode;
+    memset(&dir_inode, 0, sizeof(Inode));
+    dir_inode.inode_num = (uint32_t)inode_num;
+    dir_inode.type = 2;
+    dir_inode.used = 1;
+    dir_inode.flags = INODE_FLAG_DIR_VARLEN;
+    dir_inode.create_time = now;
+    dir_inode.modify_time = now;
+    dir_inode.blocks[0] = (uint32_t)block_num;
+    dir_inode.size = BLOCK_SIZE;
+    if (!flush_meta_block(block_num) || !write_inode(inode_num, dir_inode)) {
+        set_block_bitmap(block_num, false);
+        std::cerr << "创建目录失败：写入目录块或inode失败" << std::endl;
+        return -1;
+    }
+    set_inode_bitmap(inode_num, true);
+    alloc_lock.unlock();
+    meta_lock.unlock();
+
+    // 3. 在父目录中添加目录项
+    if (!dir_add((uint32_t)parent, name, (uint32_t)inode_num, 2)) {
+        set_block_bitmap(block_num, false);
+        set_inode_bitmap(inode_num, false);
+        return -1;
+    }
+
+    // 4. 更新父目录的修改时间（lazytime下仅暂存在内存中）
+    Inode parent_inode;
+    if (read_inode((uint32_t)parent, parent_inode)) {
+        Inode parent_orig = parent_inode;
+        parent_inode.modify_time = now;
+        update_inode((uint32_t)parent, parent_inode, parent_orig);
+    }
+    return inode_num;
+}
+
+/**
+ * @brief 删除空目录：释放目录块与inode，并从父目录中移除目录项
+ * @param path 目录的路径（不能是根目录）
+ * @return 成功返回true；目录不存在、非空或不是目录返回false
+ */
+bool DiskFS::delete_dir(const std::string& path)
+{
+    if (!isMounted()) return false;
+    std::lock_guard<SharedMutex> ns_lock(namespace_mutex);
+
+    std::string name;
+    int parent = resolve_parent(path, name);
+    if (parent == -1 || name.empty()) return false;  // 根目录不能删除
+
+    uint8_t type = 0;
+    int target = dentry_lookup((uint32_t)parent, name, &type);
+    if (target == -1 || type != 2) return false;
+    if (!dir_is_empty((uint32_t)target)) {
+        std::cerr << "删除目录失败：" << path << " 不是空目录" << std::endl;
+        return false;
+    }
+
+    // 释放目录块（线性目录块或B+树树块），标记inode为未使用
+    Inode dir_inode;
+    if (!read_inode((uint32_t)target, dir_inode)) return false;
+    free_file_blocks(dir_inode);
+    dir_inode.used = 0;
+    write_inode((uint32_t)target, dir_inode);
+    set_inode_bitmap((uint32_t)target, false);
+
+    // 丢弃该目录的内存状态与缓存条目，再从父目录中移除
+    {
+        std::lock_guard<std::mutex> states_lock(dir_states_mutex);
+        dir_states.erase((uint32_t)target);
+    }
+    dentry_drop_dir((uint32_t)target);
+    dir_remove((uint32_t)parent, name);
+
+    Inode parent_inode;
+    if (read_inode((uint32_t)parent, parent_inode)) {
+        Inode parent_orig = parent_inode;
+        parent_inode.modify_time = time(nullptr);
+        update_inode((uint32_t)parent, parent_inode, parent_orig);
+    }
+    return true;
+}
+
+/**
+ * @brief 打开目录，将游标定位到第一个目录项之前
+ * @param path 目录路径（空串或"/"表示根目录）
+ * @param cursor 输出参数：遍历游标
+ * @return 成功返回true；未挂载、目录不存在或不是目录返回false
+ */
+bool DiskFS::open_dir(const std::string& path, DirCursor& cursor)
+{
+    if (!isMounted()) return false;
+    SharedLock ns_lock(namespace_mutex);
+    int dir = resolve_path(path);
+    DirState* state = dir == -1 ? nullptr : get_dir((uint32_t)dir);
+    if (state == nullptr) return false;
+
+    cursor.dir = (uint32_t)dir;
+    cursor.block = state->tree_root != 0 ? dtree_first_leaf(state->tree_root) : 0;
+    cursor.slot = 0;
+    cursor.version = state->version;
+    cursor.tree = state->tree_root != 0;
+    cursor.last[0] = '\0';
+    return state->tree_root == 0 || cursor.block != 0;
+}
+
+/**
+ * @brief 读取游标处的下一个目录项并推进游标
+ * @param cursor 由open_dir初始化的游标
+ * @param entry 输出参数：目录项（B+树目录的记录转换为DirEntry格式）
+ * @return 读到目录项返回true；已到末尾、目录已删除或IO失败返回false
+ * 目录块经元数据缓存访问，每次只复制一个目录项，目录未被修改时不分配内存。
+ * 游标定位后目录被修改过（版本或布局不同）时按上次返回的文件名重新定位：
+ * B+树目录（包括由线性目录转换而来）从第一个大于该文件名的记录继续，叶子中的记录位置会移动，不能沿用下标；
+ * 线性目录从该文件名的记录之后继续，该记录已被删除时从块首找到不早于游标偏移的第一条记录（记录不会移动，但可能被合并）
+ */
+bool DiskFS::read_dir(DirCursor& cursor, DirEntry& entry)
+{
+    SharedLock ns_lock(namespace_mutex);
+    DirState* state = get_dir(cursor.dir);
+    if (state == nullptr) return false;
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    bool moved = cursor.version != state->version || cursor.tree != (state->tree_root != 0);
+
+    // B+树目录：沿叶子链表按文件名顺序读取
+    if (state->tree_root != 0) {
+        if (moved) {
+            if (!dtree_seek(state->tree_root, cursor.last, cursor.block, cursor.slot)) return false;
+            cursor.version = state->version;
+            cursor.tree = true;
+        }
+        if (!dtree_next(cursor.block, cursor.slot, entry)) return false;
+        strcpy(cursor.last, entry.name);
+        return true;
+    }
+
+    // 线性目录：按目录块表依次读取有效记录（跳过0号块的"."）
+    if (moved) {
+        if (cursor.tree) return false;  // B+树目录不会变回线性目录：原目录已被删除
+        const DirSlot* last = cursor.last[0] != '\0' ? state->index.find(cursor.last, strlen(cursor.last)) : nullptr;
+        char* data = last != nullptr ? get_meta_block(state->blocks[last->block].block) : nullptr;
+        if (data != nullptr) {
+            cursor.block = last->block;
+            cursor.slot = last->slot + ((const DirRecord*)(data + last->slot))->rec_len;
+            cursor.version = state->version;
+        }
+    }
+    while (cursor.block < state->blocks.size()) {
+        char* data = get_meta_block(state->blocks[cursor.block].block);
+        if (data == nullptr) return false;
+        if (cursor.version != state->version) {
+            uint32_t offset = 0;
+            while (offset < cursor.slot && record_ok(data, offset)) offset += ((DirRecord*)(data + offset))->rec_len;
+            cursor.slot = offset;
+            cursor.version = state->version;
+        }
+        while (record_ok(data, cursor.slot)) {
+            const DirRecord* record = (const DirRecord*)(data + cursor.slot);
+            bool skip = record->name_len == 0 || (cursor.block == 0 && cursor.slot == 0);
+            cursor.slot += record->rec_len;
+            if (skip) continue;
+            memcpy(entry.name, record + 1, record->name_len);
+            entry.name[record->name_len] = '\0';
+            entry.inode_num = record->inode_num;
+            entry.valid = 1;
+            entry.type = record->type;
+            strcpy(cursor.last, entry.name);
+            return true;
+        }
+        cursor.block++;
+        cursor.slot = 0;
+    }
+    return false;
+}
+
+/**
+ * @brief 经目录项缓存查找文件名对应的inode编号
+ * @param dir 所在目录的inode编号
+ * @param name 目标文件名首地址（可以是路径中的一个分量，不要求以'\0'结尾）
+ * @param len 文件名长度
+ * @param type 输出参数（可为nullptr）：文件类型（同DirEntry::type）
+ * @return 找到返回inode编号；不存在返回-1
+ * 命中（包括否定条目）时直接返回，不访问目录，也不复制文件名；未命中时查询目录并缓存结果，
+ * 因此反复探测尚不存在的文件名（TOUCH/WRITE/COPY的目标）也只在首次访问目录
+ */
+int DiskFS::dentry_lookup(uint32_t dir, const char* name, size_t len, uint8_t* type)
+{
+    {
+        std::lock_guard<std::mutex> cache_lock(dentry_mutex);
+        auto dir_it = dentry_cache.find(dir);
+        if (dir_it != dentry_cache.end()) {
+            auto it = dir_it->second.find(NameRef(name, len));
+            if (it != dir_it->second.end()) {
+                dentry_lru.splice(dentry_lru.begin(), dentry_lru, it->second);  // 移到表头
+                if (type) *type = it->second->type;
+                return it->second->inode_num;
+            }
+        }
+    }
+
+    // 查询目录时不持有缓存锁：多个共享持有目录锁的线程可能同时未命中，先后写入相同的结果
+    uint8_t found_type = 0;
+    int inode_num = dir_lookup(dir, name, len, &found_type);
+    dentry_set(dir, std::string(name, len), inode_num, found_type);
+    if (type) *type = found_type;
+    return inode_num;
+}
+
+/**
+ * @brief 写入或更新目录项缓存条目
+ * @param dir 所在目录的inode编号
+ * @param name 文件名
+ * @param inode_num 对应的inode编号；-1表示文件不存在
+ * @param type 文件类型（否定条目为0）
+ * 缓存已满时淘汰最久未使用的条目
+ */
+void DiskFS::dentry_set(uint32_t dir, const std::string& name, int inode_num, uint8_t type)
+{
+    std::lock_guard<std::mutex> cache_lock(dentry_mutex);
+    std::unordered_map<NameRef, std::list<Dentry>::iterator, NameRefHash>& names = dentry_cache[dir];
+    auto it = names.find(NameRef(name.data(), name.size()));
+    if (it != names.end()) {
+        it->second->inode_num = inode_num;
+        it->second->type = type;
+        dentry_lru.splice(dentry_lru.begin(), dentry_lru, it->second);
+        return;
+    }
+
+    // 缓存已满：淘汰表尾（最久未使用）的条目
+    if (dentry_lru.size() >= (size_t)DENTRY_CACHE_SIZE) {
+        const Dentry& victim = dentry_lru.back();
+        auto victim_dir = dentry_cache.find(victim.dir);
+        victim_dir->second.erase(NameRef(victim.name.data(), victim.name.size()));
+        if (victim_dir->second.empty() && victim.dir != dir) dentry_cache.erase(victim_dir);
+        dentry_lru.pop_back();
+    }
+
+    Dentry entry;
+    entry.dir = dir;
+    entry.name = name;
+    entry.inode_num = inode_num;
+    entry.type = type;
+    dentry_lru.push_front(entry);
+    const std::string& key = dentry_lru.front().name;  // 键引用链表节点中的文件名（节点不会移动）
+    names[NameRef(key.data(), key.size())] = dentry_lru.begin();
+}
+
+/**
+ * @brief 移除某目录下的全部缓存条目（目录被删除后，其inode编号可能分配给新目录）
+ * @param dir 目录的inode编号
+ */
+void DiskFS::dentry_drop_dir(uint32_t dir)
+{
+    std::lock_guard<std::mutex> cache_lock(dentry_mutex);
+    auto dir_it = dentry_cache.find(dir);
+    if (dir_it == dentry_cache.end()) return;
+    for (auto& item : dir_it->second) {
+        dentry_lru.erase(item.second);
+    }
+    dentry_cache.erase(dir_it);
+}
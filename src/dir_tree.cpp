@@ -0,0 +1,471 @@
+#include "../include/disk_fs.h"
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief 计算节点记录的长度（记录头 + 文件名，4字节对齐）
+ */
+static uint32_t record_size(uint32_t name_len)
+{
+    return (sizeof(DirTreeRecord) + name_len + 3) & ~3u;
+}
+
+// 一条记录（含偏移数组中的2字节）的最大长度：预分裂保证下降经过的节点至少留有这么多空间
+static const uint32_t DTREE_RECORD_MAX = sizeof(uint16_t) + record_size(MAX_FILENAME - 1);
+
+static DirTreeHeader* node_header(char* data)
+{
+    return (DirTreeHeader*)data;
+}
+
+static uint16_t* node_slots(char* data)
+{
+    return (uint16_t*)(data + sizeof(DirTreeHeader));
+}
+
+static DirTreeRecord* node_record(char* data, int index)
+{
+    return (DirTreeRecord*)(data + node_slots(data)[index]);
+}
+
+static std::string record_name(const DirTreeRecord* record)
+{
+    return std::string((const char*)(record + 1), record->name_len);
+}
+
+/**
+ * @brief 比较节点记录中的文件名与目标文件名（按字节比较，与std::string的比较顺序一致）
+ * @return 小于0、等于0、大于0
+ */
+static int compare_name(const DirTreeRecord* record, const std::string& name)
+{
+    size_t len = record->name_len < name.size() ? record->name_len : name.size();
+    int result = memcmp(record + 1, name.data(), len);
+    if (result != 0) return result;
+    return (int)record->name_len - (int)name.size();
+}
+
+/**
+ * @brief 在节点的有序记录中二分查找
+ * @return 最后一个name <= 目标文件名的记录下标；不存在返回-1
+ */
+static int find_dtree_slot(char* data, const std::string& name)
+{
+    int lo = 0, hi = node_header(data)->entries - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (compare_name(node_record(data, mid), name) <= 0) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief 初始化空节点
+ */
+static void node_init(char* data, uint16_t depth, uint32_t next)
+{
+    memset(data, 0, BLOCK_SIZE);
+    node_header(data)->depth = depth;
+    node_header(data)->next = next;
+    node_header(data)->heap = BLOCK_SIZE;
+}
+
+/**
+ * @brief 计算节点整理后的可用空间（不计删除留下的空洞）
+ */
+static uint32_t node_free(char* data)
+{
+    uint32_t used = sizeof(DirTreeHeader);
+    for (int i = 0; i < node_header(data)->entries; i++) {
+        used += sizeof(uint16_t) + record_size(node_record(data, i)->name_len);
+    }
+    return BLOCK_SIZE - used;
+}
+
+/**
+ * @brief 整理节点：将有效记录紧密排列到块尾，回收删除留下的空洞
+ */
+static void node_compact(char* data)
+{
+    std::vector<char> copy(data, data + BLOCK_SIZE);
+    DirTreeHeader* header = node_header(data);
+    header->heap = BLOCK_SIZE;
+    for (int i = 0; i < header->entries; i++) {
+        DirTreeRecord* record = node_record(copy.data(), i);
+        uint32_t size = record_size(record->name_len);
+        header->heap -= size;
+        memcpy(data + header->heap, record, size);
+        node_slots(data)[i] = header->heap;
+    }
+}
+
+/**
+ * @brief 在节点的pos处插入一条记录（调用者已保证node_free足够）
+ */
+static void node_insert(char* data, int pos, const std::string& name, uint8_t type, uint32_t value)
+{
+    DirTreeHeader* header = node_header(data);
+    uint32_t size = record_size(name.size());
+    uint32_t slots_end = sizeof(DirTreeHeader) + (header->entries + 1) * sizeof(uint16_t);
+    if (header->heap < slots_end + size) node_compact(data);
+
+    header->heap -= size;
+    DirTreeRecord* record = (DirTreeRecord*)(data + header->heap);
+    memset(record, 0, size);
+    record->value = value;
+    record->type = type;
+    record->name_len = (uint8_t)name.size();
+    memcpy(record + 1, name.data(), name.size());
+
+    uint16_t* slots = node_slots(data);
+    memmove(slots + pos + 1, slots + pos, (header->entries - pos) * sizeof(uint16_t));
+    slots[pos] = header->heap;
+    header->entries++;
+}
+
+/**
+ * @brief 移除节点中pos处的记录（记录空间留作空洞，之后整理时回收）
+ */
+static void node_remove(char* data, int pos)
+{
+    DirTreeHeader* header = node_header(data);
+    uint16_t* slots = node_slots(data);
+    memmove(slots + pos, slots + pos + 1, (header->entries - pos - 1) * sizeof(uint16_t));
+    header->entries--;
+}
+
+/**
+ * @brief 将叶子记录转换为DirEntry
+ */
+static void fill_dir_entry(DirEntry& entry, const DirTreeRecord* record)
+{
+    memset(&entry, 0, sizeof(DirEntry));
+    memcpy(entry.name, record + 1, record->name_len);
+    entry.inode_num = record->value;
+    entry.valid = 1;
+    entry.type = record->type;
+}
+
+/**
+ * @brief 初始化一个空的B+树目录（只含一个空叶子作为树根）
+ * @return 树根块号；分配失败返回0
+ */
+uint32_t DiskFS::dtree_create()
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    int root = alloc_block();
+    if (root == -1) return 0;
+    char* data = get_meta_block(root, true);
+    if (data == nullptr) {
+        set_block_bitmap(root, false);
+        return 0;
+    }
+    node_init(data, 0, 0);
+    if (!flush_meta_block(root)) return 0;
+    return (uint32_t)root;
+}
+
+/**
+ * @brief 自树根向下查找文件名所在的叶子块
+ * @param root 树根块号
+ * @param name 目标文件名
+ * @return 叶子块号；IO失败返回0
+ * 每层一次二分查找，树块经元数据缓存访问，读取块数不超过树高
+ */
+uint32_t DiskFS::dtree_find_leaf(uint32_t root, const std::string& name)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    uint32_t node_block = root;
+    while (true) {
+        char* data = get_meta_block(node_block);
+        if (data == nullptr) return 0;
+        if (node_header(data)->depth == 0) return node_block;
+
+        int slot = find_dtree_slot(data, name);
+        node_block = node_record(data, slot < 0 ? 0 : slot)->value;
+    }
+}
+
+/**
+ * @brief 在B+树目录中按文件名查找inode编号
+ * @param root 树根块号
+ * @param name 目标文件名
+ * @param type 输出参数（可为nullptr）：目录项记录的文件类型
+ * @return 找到返回inode编号；不存在或IO失败返回-1
+ */
+int DiskFS::dtree_lookup(uint32_t root, const std::string& name, uint8_t* type)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    uint32_t leaf = dtree_find_leaf(root, name);
+    if (leaf == 0) return -1;
+    char* data = get_meta_block(leaf);
+    if (data == nullptr) return -1;
+
+    int slot = find_dtree_slot(data, name);
+    if (slot < 0 || compare_name(node_record(data, slot), name) != 0) return -1;
+    if (type) *type = node_record(data, slot)->type;
+    return (int)node_record(data, slot)->value;
+}
+
+/**
+ * @brief 向B+树目录插入一条目录项
+ * @param root 树根块号
+ * @param name 文件名（调用者已检查重名）
+ * @param inode_num 文件的inode编号
+ * @param type 文件类型（1：普通文件，2：目录）
+ * @return 插入成功返回true；分配树块失败或IO失败返回false
+ * 与extent树相同，采用自顶向下的预分裂：下降前若子节点剩余空间不足一条最长记录则先按字节数对半分裂；
+ * 树根空间不足时将其内容下移到新块，树根块号保持不变，树高加1
+ */
+bool DiskFS::dtree_insert(uint32_t root, const std::string& name, uint32_t inode_num, uint8_t type)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    // 1. 树根空间不足：将树根内容下移到新块，树根变为只含一条索引记录的节点
+    char* root_data = get_meta_block(root);
+    if (root_data == nullptr) return false;
+    if (node_free(root_data) < DTREE_RECORD_MAX) {
+        std::vector<char> copy(root_data, root_data + BLOCK_SIZE);
+        int child = alloc_block();
+        if (child == -1) return false;
+        char* data = get_meta_block(child, true);
+        if (data == nullptr) return false;
+        memcpy(data, copy.data(), BLOCK_SIZE);
+        flush_meta_block(child);
+
+        root_data = get_meta_block(root);
+        if (root_data == nullptr) return false;
+        node_init(root_data, node_header(copy.data())->depth + 1, 0);
+        node_insert(root_data, 0, "", 0, (uint32_t)child);
+        flush_meta_block(root);
+    }
+
+    // 2. 自根向下，逐层定位子节点（get_meta_block可能淘汰其他缓存块，访问其他树块后重新获取指针）
+    uint32_t node_block = root;
+    while (true) {
+        char* data = get_meta_block(node_block);
+        if (data == nullptr) return false;
+
+        // 到达叶子：按文件名有序插入
+        if (node_header(data)->depth == 0) {
+            node_insert(data, find_dtree_slot(data, name) + 1, name, type, inode_num);
+            return flush_meta_block(node_block);
+        }
+
+        // 索引节点：选择子节点（首条记录的下界视为无穷小）
+        int slot = find_dtree_slot(data, name);
+        if (slot < 0) slot = 0;
+        uint32_t child = node_record(data, slot)->value;
+
+        // 子节点空间不足：先按字节数对半分裂，将后一半移到新的兄弟块
+        char* child_data = get_meta_block(child);
+        if (child_data == nullptr) return false;
+        if (node_free(child_data) < DTREE_RECORD_MAX) {
+            std::vector<char> copy(child_data, child_data + BLOCK_SIZE);
+            DirTreeHeader* copy_header = node_header(copy.data());
+            uint32_t total = BLOCK_SIZE - node_free(copy.data()), used = 0;
+            int half = 0;
+            while (half < copy_header->entries - 1 && used < total / 2) {
+                used += sizeof(uint16_t) + record_size(node_record(copy.data(), half)->name_len);
+                half++;
+            }
+            if (half == 0) half = 1;
+            std::string separator = record_name(node_record(copy.data(), half));
+
+            int sibling = alloc_block_near(child);
+            if (sibling == -1) return false;
+            char* sibling_data = get_meta_block(sibling, true);
+            if (sibling_data == nullptr) return false;
+            node_init(sibling_data, copy_header->depth, copy_header->next);  // 兄弟叶子接入叶子链表
+            for (int i = half; i < copy_header->entries; i++) {
+                DirTreeRecord* record = node_record(copy.data(), i);
+                node_insert(sibling_data, i - half, record_name(record), record->type, record->value);
+            }
+            flush_meta_block(sibling);
+
+            child_data = get_meta_block(child);
+            if (child_data == nullptr) return false;
+            node_init(child_data, copy_header->depth, copy_header->depth == 0 ? (uint32_t)sibling : 0);
+            for (int i = 0; i < half; i++) {
+                DirTreeRecord* record = node_record(copy.data(), i);
+                node_insert(child_data, i, record_name(record), record->type, record->value);
+            }
+            flush_meta_block(child);
+
+            // 在父节点slot之后插入指向兄弟块的索引记录（键为兄弟块的首个文件名）
+            data = get_meta_block(node_block);
+            if (data == nullptr) return false;
+            node_insert(data, slot + 1, separator, 0, (uint32_t)sibling);
+            flush_meta_block(node_block);
+
+            if (separator <= name) child = (uint32_t)sibling;
+        }
+        node_block = child;
+    }
+}
+
+/**
+ * @brief 从B+树目录中删除一条目录项
+ * @param root 树根块号
+ * @param name 目标文件名
+ * @return 删除成功返回true；不存在或IO失败返回false
+ * 只从叶子中移除记录，不合并节点：索引键仍是各子树文件名的下界，查找结果不受影响；
+ * 空叶子保留在树和叶子链表中，之后插入的文件名可以复用
+ */
+bool DiskFS::dtree_remove(uint32_t root, const std::string& name)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    uint32_t leaf = dtree_find_leaf(root, name);
+    if (leaf == 0) return false;
+    char* data = get_meta_block(leaf);
+    if (data == nullptr) return false;
+
+    int slot = find_dtree_slot(data, name);
+    if (slot < 0 || compare_name(node_record(data, slot), name) != 0) return false;
+    node_remove(data, slot);
+    return flush_meta_block(leaf);
+}
+
+/**
+ * @brief 查找B+树目录最左侧的叶子（按文件名顺序遍历的起点）
+ * @param root 树根块号
+ * @return 叶子块号；IO失败返回0
+ */
+uint32_t DiskFS::dtree_first_leaf(uint32_t root)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    uint32_t node_block = root;
+    while (true) {
+        char* data = get_meta_block(node_block);
+        if (data == nullptr) return 0;
+        if (node_header(data)->depth == 0) return node_block;
+        node_block = node_record(data, 0)->value;
+    }
+}
+
+/**
+ * @brief 沿叶子链表收集B+树目录中全部文件名的哈希值
+ * @param root 树根块号
+ * @param hashes 输出参数：追加的哈希值
+ * @return 成功返回true；IO失败返回false
+ */
+bool DiskFS::dtree_hash_names(uint32_t root, std::vector<size_t>& hashes)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    for (uint32_t leaf = dtree_first_leaf(root); leaf != 0; ) {
+        char* data = get_meta_block(leaf);
+        if (data == nullptr) return false;
+        for (int i = 0; i < node_header(data)->entries; i++) {
+            const DirTreeRecord* record = node_record(data, i);
+            hashes.push_back(dir_name_hash((const char*)(record + 1), record->name_len));
+        }
+        leaf = node_header(data)->next;
+    }
+    return root != 0;
+}
+
+/**
+ * @brief 按文件名顺序收集B+树目录中位于[first, last)内的目录项
+ * @param root 树根块号
+ * @param first 下界（含）
+ * @param last 上界（不含），空串表示无上界
+ * @param entries 输出参数：追加的目录项
+ * @return 成功返回true；IO失败返回false
+ * 自树根定位first所在的叶子，再沿叶子链表读取，遇到不小于last的文件名即停止，
+ * 读取的块数与树高及结果数成正比（删除后残留的空叶子会被直接跳过）
+ */
+bool DiskFS::dtree_range(uint32_t root, const std::string& first, const std::string& last, std::vector<DirEntry>& entries)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    uint32_t leaf = dtree_find_leaf(root, first);
+    bool first_leaf = true;
+    while (leaf != 0) {
+        char* data = get_meta_block(leaf);
+        if (data == nullptr) return false;
+        // 首个叶子中从第一个不小于first的记录开始，之后的叶子从头开始
+        int start = 0;
+        if (first_leaf) {
+            start = find_dtree_slot(data, first);
+            if (start < 0 || compare_name(node_record(data, start), first) < 0) start++;
+            first_leaf = false;
+        }
+        for (int i = start; i < node_header(data)->entries; i++) {
+            DirTreeRecord* record = node_record(data, i);
+            if (!last.empty() && compare_name(record, last) >= 0) return true;
+
+            DirEntry entry;
+            fill_dir_entry(entry, record);
+            entries.push_back(entry);
+        }
+        leaf = node_header(data)->next;
+    }
+    return true;
+}
+
+/**
+ * @brief 定位到B+树目录中第一个大于after的目录项
+ * @param root 树根块号
+ * @param after 已读到的文件名（空串表示从第一个目录项开始）
+ * @param leaf 输出参数：所在叶子块号
+ * @param slot 输出参数：记录在叶子中的下标（可能等于叶子的记录数，此时由dtree_next转到下一个叶子）
+ * @return 成功返回true；IO失败返回false
+ */
+bool DiskFS::dtree_seek(uint32_t root, const std::string& after, uint32_t& leaf, uint32_t& slot)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    slot = 0;
+    if (after.empty()) {
+        leaf = dtree_first_leaf(root);
+        return leaf != 0;
+    }
+    leaf = dtree_find_leaf(root, after);
+    char* data = leaf != 0 ? get_meta_block(leaf) : nullptr;
+    if (data == nullptr) return false;
+    slot = (uint32_t)(find_dtree_slot(data, after) + 1);  // 不大于after的最后一条记录之后
+    return true;
+}
+
+/**
+ * @brief 读取叶子链表中的下一条目录项并推进位置
+ * @param leaf 当前叶子块号（读到末尾时置为0）
+ * @param slot 下一条记录在叶子中的下标
+ * @param entry 输出参数：目录项
+ * @return 读到目录项返回true；已到末尾或IO失败返回false
+ */
+bool DiskFS::dtree_next(uint32_t& leaf, uint32_t& slot, DirEntry& entry)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    while (leaf != 0) {
+        char* data = get_meta_block(leaf);
+        if (data == nullptr) return false;
+        if (slot < node_header(data)->entries) {
+            fill_dir_entry(entry, node_record(data, slot++));
+            return true;
+        }
+        leaf = node_header(data)->next;
+        slot = 0;
+    }
+    return false;
+}
+
+/**
+ * @brief 递归释放B+树目录的树块
+ * @param block_num 子树根的块号
+ */
+void DiskFS::dtree_free(uint32_t block_num)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    char* data = get_meta_block(block_num);
+    if (data != nullptr && node_header(data)->depth > 0) {
+        // 先复制子节点块号，递归过程中缓存块可能被淘汰
+        std::vector<uint32_t> children;
+        for (int i = 0; i < node_header(data)->entries; i++) children.push_back(node_record(data, i)->value);
+        for (uint32_t child : children) dtree_free(child);
+    }
+    drop_meta_block(block_num);
+    set_block_bitmap(block_num, false);
+}
@@ -2,13 +2,31 @@
 #include <cstring>
 #include <iostream>
 #include <ctime>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+/**
+ * @brief SIMFSv1的inode布局（仅用于升级）
+ * v1直接以sizeof(Inode)定位inode，time_t导致结构体大小依赖平台（x86_64下为96字节）
+ */
+struct InodeV1
+{
+    uint32_t inode_num;
+    uint32_t size;
+    uint32_t blocks[16];
+    uint8_t type;
+    uint8_t used;
+    time_t create_time;
+    time_t modify_time;
+};
 
 /**
  * @brief 构造函数：初始化磁盘路径和挂载状态
  * @param path 磁盘文件的路径（如"disk.img"）
  * 初始化时磁盘未挂载，仅记录磁盘文件的路径供后续操作使用
  */
-DiskFS::DiskFS(const std::string& path) : disk_path(path), is_mounted(false) {}
+DiskFS::DiskFS(const std::string& path) : disk_path(path), is_mounted(false), dir_versions(0), inode_table_loaded(false) {}
 
 /**
  * @brief 析构函数：确保磁盘在对象销毁前正确卸载
@@ -36,6 +54,10 @@ bool DiskFS::format()
         disk_file.open(disk_path, std::ios::trunc | std::ios::out | std::ios::in | std::ios::binary);
         if (!disk_file) return false;  // 创建失败则返回错误
     }
+    // 位图与inode表将被整体重写，丢弃可能残留的缓存
+    bitmap_cache.clear();
+    inode_table.clear();
+    inode_table_loaded = false;
 
     /**
     * 计算文件系统各区域的块数（磁盘布局规划）
@@ -55,7 +77,7 @@ bool DiskFS::format()
     
     // 初始化超级块（文件系统的元数据核心）
     memset(&super_block, 0, sizeof(SuperBlock));  // 先清空所有字段
-    strcpy(super_block.magic, "SIMFSv1");  // 设置文件系统标识（用于挂载时验证）
+    strcpy(super_block.magic, FS_MAGIC);   // 设置文件系统标识（用于挂载时验证）
     super_block.block_size = BLOCK_SIZE;   // 块大小（4KB）
     super_block.total_blocks = MAX_BLOCKS; // 总块数（由磁盘大小和块大小决定）
     super_block.inode_blocks = inode_area_size;  // inode区占用的块数
@@ -94,14 +116,16 @@ bool DiskFS::format()
     set_inode_bitmap(0, true);
 
     // 初始化所有inode为未使用状态（默认值）
-    Inode inode;
-    memset(&inode, 0, sizeof(Inode));  // 清空inode结构
-    for (uint32_t i = 1; i < MAX_INODES; i++)
+    // inode表块按整块写入：每块即INODES_PER_BLOCK个连续的Inode
+    Inode* table = (Inode*)buffer;
+    for (uint32_t b = 0; b < inode_area_size; b++)
     {
-        inode.inode_num = i;  // 设置inode编号
-        inode.used = 0;       // 标记为未使用
-        disk_file.seekp(get_inode_pos(i));  // 定位到该inode在磁盘中的位置
-        disk_file.write((char*)&inode, sizeof(Inode));  // 写入inode数据
+        memset(buffer, 0, BLOCK_SIZE);
+        for (int j = 0; j < INODES_PER_BLOCK; j++)
+        {
+            table[j].inode_num = b * INODES_PER_BLOCK + j;  // 设置inode编号（used保持0，即未使用）
+        }
+        write_block(super_block.inode_start + b, buffer);
     }
 
     // 为根目录分配一个数据块（存储目录项）
@@ -120,6 +144,7 @@ bool DiskFS::format()
     root_inode.inode_num = 0;
     root_inode.type = 2;  // 类型标识：2表示目录（1表示普通文件）
     root_inode.used = 1;  // 标记为已使用
+    root_inode.flags = INODE_FLAG_DIR_VARLEN;  // 目录项为变长记录格式
     root_inode.create_time = now;  // 创建时间
     root_inode.modify_time = now;  // 修改时间（初始与创建时间相同）
 
@@ -127,25 +152,23 @@ bool DiskFS::format()
     root_inode.blocks[0] = root_block;  // 根目录的数据块指针指向该块
     root_inode.size = BLOCK_SIZE;       // 根目录大小为1个块（4KB）
 
-    // 将初始化好的根目录inode写入磁盘
-    disk_file.seekp(get_inode_pos(0));
-    disk_file.write((char*)&root_inode, sizeof(Inode));
-
-    // 检查写入是否成功
-    if (disk_file.fail()) {
+    // 将初始化好的根目录inode写入磁盘，并检查写入是否成功
+    if (!write_inode(0, root_inode)) {
         std::cerr << "根目录inode写入失败！" << std::endl;
     } else {
         std::cerr << "根目录inode写入成功" << std::endl;
     }
     
-    // 初始化根目录内容：包含"当前目录"（.）的目录项
+    // 初始化根目录内容：只含"当前目录"（.）一条记录，记录长度覆盖整个块
     memset(buffer, 0, BLOCK_SIZE);  // 清空缓冲区
-    DirEntry* root_entry = (DirEntry*)buffer;  // 将缓冲区视为目录项数组
+    DirRecord* root_record = (DirRecord*)buffer;  // 块首的目录记录
 
     // 初始化"."（当前目录）：指向根目录自身的inode（0号）
-    strcpy(root_entry[0].name, ".");
-    root_entry[0].inode_num = 0;  // 关联0号inode（根目录）
-    root_entry[0].valid = 1;      // 标记为有效
+    root_record->inode_num = 0;  // 关联0号inode（根目录）
+    root_record->rec_len = BLOCK_SIZE;
+    root_record->name_len = 1;
+    root_record->type = 2;
+    memcpy(root_record + 1, ".", 1);
 
     set_block_bitmap(root_block, true);  // 标记该块为已使用（更新块位图）
             
@@ -157,15 +180,17 @@ bool DiskFS::format()
 
 /**
  * @brief 挂载磁盘：加载文件系统到内存，准备进行操作
+ * @param options 挂载选项（如新建文件是否使用extent树映射）
  * @return 挂载成功返回true；文件打开失败或文件系统标识不匹配返回false
  * 挂载是使用磁盘前的必要步骤，会验证文件系统合法性并加载超级块到内存
  */
-bool DiskFS::mount()
+bool DiskFS::mount(const MountOptions& options)
 {
     if (is_mounted) 
     {
         return true;  // 若已挂载，直接返回成功
     }
+    mount_options = options;
 
     // 以读写+二进制模式打开磁盘文件
     disk_file.open(disk_path, std::ios::in | std::ios::out | std::ios::binary);
@@ -178,12 +203,54 @@ bool DiskFS::mount()
     disk_file.seekg(0);
     disk_file.read((char*)&super_block, sizeof(SuperBlock));
 
-    // 验证文件系统标识（必须为"SIMFSv1"，确保是兼容的文件系统）
-    if (strncmp(super_block.magic, "SIMFSv1", 7) != 0) {
+    // 旧版SIMFSv1镜像：inode大小依赖平台的time_t与填充，需先原地升级为SIMFSv2
+    if (strncmp(super_block.magic, FS_MAGIC_V1, sizeof(FS_MAGIC_V1)) == 0) {
+        std::cerr << "检测到SIMFSv1镜像，正在升级到SIMFSv2..." << std::endl;
+        if (!upgrade_from_v1()) {
+            std::cerr << "SIMFSv1镜像升级失败" << std::endl;
+            disk_file.close();
+            return false;
+        }
+    }
+
+    // 验证文件系统标识（必须为"SIMFSv2"，确保是兼容的文件系统）
+    if (strncmp(super_block.magic, FS_MAGIC, sizeof(FS_MAGIC)) != 0) {
         disk_file.close();  // 标识不匹配，关闭文件
         return false;
     }
 
+    // 丢弃残留的位图缓存（升级过程会直接改写块位图）
+    bitmap_cache.clear();
+
+    // 预加载：后台线程以独立文件流顺序读入整个inode表，同时本线程将所有位图读入缓存
+    if (mount_options.preload) {
+        disk_file.flush();  // 确保升级等写入对独立文件流可见
+        bool table_ok = false;
+        std::thread loader([this, &table_ok]() { table_ok = load_inode_table(); });
+        bool bitmaps_ok = load_bitmaps();
+        loader.join();
+        if (!table_ok || !bitmaps_ok) {
+            std::cerr << "预加载inode表或位图失败" << std::endl;
+            bitmap_cache.clear();
+            inode_table.clear();
+            disk_file.close();
+            return false;
+        }
+        inode_table_loaded = true;
+    }
+
+    // 重建共享尾部块的片段占用情况（已预加载时直接扫描内存中的inode表）与根目录的哈希索引
+    // （其他目录的索引在首次访问时建立）
+    dir_states.clear();
+    if (!load_tail_slots() || get_dir(0) == nullptr) {
+        dir_states.clear();
+        inode_table.clear();
+        inode_table_loaded = false;
+        tail_slots.clear();
+        disk_file.close();
+        return false;
+    }
+
     is_mounted = true;  // 标记为已挂载状态
     return true;
 }
@@ -197,11 +264,147 @@ bool DiskFS::unmount()
 {
     if (!is_mounted) return true;  // 若未挂载，直接返回成功
 
+    // 写回lazytime暂存的修改时间
+    if (!flush_pending_times()) {
+        std::cerr << "警告：部分inode修改时间写回失败" << std::endl;
+    }
+    pending_mtimes.clear();
+
     // 将内存中的超级块写回磁盘（保存最新的元数据）
     disk_file.seekp(0);
     disk_file.write((char*)&super_block, sizeof(SuperBlock));
     
     disk_file.close();  // 关闭磁盘文件
     is_mounted = false;  // 标记为未挂载状态
+
+    // 清空元数据块缓存、位图缓存、预加载的inode表、尾部片段表、目录索引与目录项缓存（仅对当前挂载的镜像有效）
+    meta_cache.clear();
+    meta_lru.clear();
+    bitmap_cache.clear();
+    inode_table.clear();
+    inode_table_loaded = false;
+    tail_slots.clear();
+    dir_states.clear();
+    dentry_cache.clear();
+    dentry_lru.clear();
     return true;
 }
+
+/**
+ * @brief 同步：将内存中暂存的元数据写回磁盘（不卸载）
+ * @return 成功返回true；未挂载或IO失败返回false
+ * 目前暂存的元数据只有lazytime下延迟写回的inode修改时间；位图与其它inode修改均为写穿。
+ * 持有目录锁，避免写回的目录inode覆盖并发创建/删除对目录inode的修改
+ */
+bool DiskFS::sync()
+{
+    if (!is_mounted) return false;
+    std::lock_guard<SharedMutex> ns_lock(namespace_mutex);
+    if (!flush_pending_times()) return false;
+    std::lock_guard<std::mutex> io_lock(io_mutex);
+    disk_file.flush();
+    return disk_file.good();
+}
+
+/**
+ * @brief 将SIMFSv1镜像原地升级为SIMFSv2格式
+ * @return 升级成功返回true（内存中的超级块已更新为v2）；IO失败或空间不足返回false
+ * v2的inode表比v1大，升级时inode区向后扩展，占用数据区开头的若干块：
+ * 1. 读入v1的inode表和块位图；
+ * 2. 将落在扩展区域内的已用数据块搬迁到新数据区中的空闲块，并修正块指针；
+ * 3. 以定长格式写入新inode表，按新的数据区起点重建块位图；
+ * 4. 最后写入v2超级块。升级过程不可中断，建议事先备份镜像文件
+ */
+bool DiskFS::upgrade_from_v1()
+{
+    if (super_block.block_size != BLOCK_SIZE) return false;
+
+    const uint32_t total_inodes = super_block.total_inodes;
+    const uint32_t old_data_start = super_block.data_start;
+    const uint32_t total_blocks = super_block.total_blocks;
+
+    // 1. 读入v1 inode表（v1按sizeof(InodeV1)紧密排列）
+    std::vector<InodeV1> old_inodes(total_inodes);
+    disk_file.seekg(super_block.inode_start * BLOCK_SIZE);
+    disk_file.read((char*)old_inodes.data(), total_inodes * sizeof(InodeV1));
+    if (!disk_file.good()) return false;
+
+    // 读入v1块位图，转换为按绝对块号索引的使用标记
+    uint32_t block_bitmap_size = ((MAX_BLOCKS + 7) / 8 + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    std::vector<char> bitmap(block_bitmap_size * BLOCK_SIZE);
+    for (uint32_t i = 0; i < block_bitmap_size; i++) {
+        if (!read_block(super_block.block_bitmap + i, &bitmap[i * BLOCK_SIZE])) return false;
+    }
+    std::vector<bool> block_used(total_blocks, false);
+    for (uint32_t idx = 0; old_data_start + idx < total_blocks; idx++) {
+        if (bitmap[idx / 8] & (1 << (idx % 8))) {
+            block_used[old_data_start + idx] = true;
+        }
+    }
+
+    // 2. 计算新的inode区大小与数据区起点
+    uint32_t new_inode_blocks = (total_inodes * INODE_SIZE + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t new_data_start = super_block.inode_start + new_inode_blocks;
+    if (new_data_start < old_data_start) new_data_start = old_data_start;
+
+    // 搬迁落在[old_data_start, new_data_start)内的已用数据块
+    char buffer[BLOCK_SIZE];
+    uint32_t next_free = new_data_start;
+    for (uint32_t i = 0; i < total_inodes; i++) {
+        if (!old_inodes[i].used) continue;
+        for (int k = 0; k < 16; k++) {
+            uint32_t block_num = old_inodes[i].blocks[k];
+            if (block_num == 0 || block_num >= new_data_start) continue;
+
+            while (next_free < total_blocks && block_used[next_free]) next_free++;
+            if (next_free >= total_blocks) return false;  // 没有足够的空闲块完成搬迁
+
+            if (!read_block(block_num, buffer) || !write_block(next_free, buffer)) return false;
+            block_used[block_num] = false;
+            block_used[next_free] = true;
+            old_inodes[i].blocks[k] = next_free;
+        }
+    }
+
+    // 3. 写入定长格式的新inode表（整块写入）
+    Inode* table = (Inode*)buffer;
+    for (uint32_t b = 0; b < new_inode_blocks; b++) {
+        memset(buffer, 0, BLOCK_SIZE);
+        for (int j = 0; j < INODES_PER_BLOCK; j++) {
+            uint32_t i = b * INODES_PER_BLOCK + j;
+            if (i >= total_inodes) break;
+            table[j].inode_num = i;
+            table[j].size = old_inodes[i].size;
+            table[j].create_time = old_inodes[i].create_time;
+            table[j].modify_time = old_inodes[i].modify_time;
+            table[j].type = old_inodes[i].type;
+            table[j].used = old_inodes[i].used;
+            memcpy(table[j].blocks, old_inodes[i].blocks, sizeof(table[j].blocks));
+        }
+        if (!write_block(super_block.inode_start + b, buffer)) return false;
+    }
+
+    // 按新的数据区起点重建块位图
+    std::fill(bitmap.begin(), bitmap.end(), 0);
+    uint32_t used_count = 0;
+    for (uint32_t block_num = new_data_start; block_num < total_blocks; block_num++) {
+        if (!block_used[block_num]) continue;
+        uint32_t idx = block_num - new_data_start;
+        bitmap[idx / 8] |= (1 << (idx % 8));
+        used_count++;
+    }
+    for (uint32_t i = 0; i < block_bitmap_size; i++) {
+        if (!write_block(super_block.block_bitmap + i, &bitmap[i * BLOCK_SIZE])) return false;
+    }
+
+    // 4. 更新并写入v2超级块
+    memset(super_block.magic, 0, sizeof(super_block.magic));
+    strcpy(super_block.magic, FS_MAGIC);
+    super_block.data_blocks -= new_data_start - old_data_start;
+    super_block.inode_blocks = new_inode_blocks;
+    super_block.data_start = new_data_start;
+    super_block.free_blocks = super_block.data_blocks - used_count;
+    super_block.inode_chunk_count = 0;  // v1没有动态inode表块组
+    memset(super_block.inode_chunks, 0, sizeof(super_block.inode_chunks));
+    return write_super_block();
+}
@@ -0,0 +1,285 @@
+#include "../include/disk_fs.h"
+#include <cstring>
+#include <vector>
+
+
+/**
+ * @brief 在节点的有序记录中二分查找
+ * @return 最后一个logical <= block_idx的记录下标；不存在返回-1
+ */
+static int find_extent_slot(const Extent* ext, int count, uint32_t block_idx)
+{
+    int lo = 0, hi = count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (ext[mid].logical <= block_idx) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief 通过extent树将逻辑块号映射为磁盘块号
+ * @param inode 文件的inode（blocks区域存放extent树根，分配时可能被修改，调用者负责写回）
+ * @param block_idx 逻辑块号
+ * @param alloc true表示逻辑块未映射时分配新块
+ * @param is_new 输出参数（可为nullptr）：数据块是否为本次新分配的块
+ * @return 磁盘块号；未映射（alloc为false）或分配失败返回0
+ * 查找自根向下逐层二分，树块经元数据缓存访问；连续写入时新块优先紧随前一段extent分配，
+ * 并直接延长该extent，大文件顺序写通常只需少量extent记录
+ */
+uint32_t DiskFS::extent_map(Inode& inode, uint32_t block_idx, bool alloc, bool* is_new)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    if (is_new) *is_new = false;
+
+    // 1. 自根向下查找叶子节点
+    ExtentHeader* header = (ExtentHeader*)inode.blocks;
+    Extent* ext = (Extent*)(header + 1);
+    uint32_t leaf_block = 0;  // 叶子所在的块号（0表示叶子就是inode内的树根）
+    while (header->depth > 0) {
+        int slot = find_extent_slot(ext, header->entries, block_idx);
+        leaf_block = ext[slot < 0 ? 0 : slot].physical;
+        char* data = get_meta_block(leaf_block);
+        if (data == nullptr) return 0;
+        header = (ExtentHeader*)data;
+        ext = (Extent*)(header + 1);
+    }
+
+    // 2. 在叶子中查找覆盖block_idx的extent
+    int slot = find_extent_slot(ext, header->entries, block_idx);
+    if (slot >= 0 && block_idx < ext[slot].logical + ext[slot].length) {
+        return ext[slot].physical + (block_idx - ext[slot].logical);
+    }
+    if (!alloc) return 0;
+
+    // 3. 分配新块：优先选择与前一段extent物理连续的位置
+    int block_num;
+    bool can_extend = false;
+    if (slot >= 0) {
+        uint32_t goal = ext[slot].physical + (block_idx - ext[slot].logical);
+        can_extend = (block_idx == ext[slot].logical + ext[slot].length);
+        block_num = alloc_block_near(goal);
+        // 恰好分配到紧随其后的块：直接延长该extent（分配过程不访问元数据缓存，ext仍然有效）
+        if (block_num != -1 && can_extend && (uint32_t)block_num == goal) {
+            ext[slot].length++;
+            if (leaf_block != 0) flush_meta_block(leaf_block);
+            if (is_new) *is_new = true;
+            return (uint32_t)block_num;
+        }
+    } else {
+        block_num = alloc_block();
+    }
+    if (block_num == -1) return 0;
+
+    // 4. 无法延长时插入一条新的extent记录
+    Extent new_ext;
+    new_ext.logical = block_idx;
+    new_ext.physical = (uint32_t)block_num;
+    new_ext.length = 1;
+    if (!extent_insert(inode, new_ext)) {
+        set_block_bitmap(block_num, false);
+        return 0;
+    }
+    if (is_new) *is_new = true;
+    return (uint32_t)block_num;
+}
+
+/**
+ * @brief 向extent树插入一条叶子记录
+ * @param inode 文件的inode（树根可能被修改，调用者负责写回）
+ * @param new_ext 待插入的记录（其逻辑范围不能与已有记录重叠）
+ * @return 插入成功返回true；分配树块失败或IO失败返回false
+ * 采用自顶向下的预分裂：下降前若子节点已满则先将其对半分裂，保证父节点总有空位；
+ * 树根（位于inode内）已满时整体下移到新块，树高加1
+ */
+bool DiskFS::extent_insert(Inode& inode, const Extent& new_ext)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    // 获取节点头：块号为0表示inode内的树根（注意：get_meta_block可能淘汰其他缓存块，
+    // 因此每次访问其他树块后都重新获取节点指针）
+    auto node_header = [&](uint32_t block_num) -> ExtentHeader* {
+        if (block_num == 0) return (ExtentHeader*)inode.blocks;
+        return (ExtentHeader*)get_meta_block(block_num);
+    };
+
+    // 1. 树根已满：将树根内容下移到新块，树根变为只含一条索引记录的节点
+    //    （索引键沿用原首条记录的logical，即子树中最小的逻辑块号）
+    ExtentHeader* root = (ExtentHeader*)inode.blocks;
+    if (root->entries >= EXTENT_ROOT_MAX) {
+        int child = alloc_block();
+        if (child == -1) return false;
+        char* data = get_meta_block(child, true);
+        if (data == nullptr) return false;
+        memcpy(data, inode.blocks, sizeof(inode.blocks));
+        flush_meta_block(child);
+
+        Extent* root_ext = (Extent*)(root + 1);
+        root_ext[0].physical = (uint32_t)child;
+        root_ext[0].length = 0;
+        root->entries = 1;
+        root->depth++;
+    }
+
+    // 2. 自根向下，逐层定位子节点
+    uint32_t node_block = 0;
+    while (true) {
+        ExtentHeader* header = node_header(node_block);
+        if (header == nullptr) return false;
+        Extent* ext = (Extent*)(header + 1);
+
+        // 到达叶子：按逻辑块号有序插入
+        if (header->depth == 0) {
+            int pos = find_extent_slot(ext, header->entries, new_ext.logical) + 1;
+            memmove(ext + pos + 1, ext + pos, (header->entries - pos) * sizeof(Extent));
+            ext[pos] = new_ext;
+            header->entries++;
+            if (node_block != 0) flush_meta_block(node_block);
+            return true;
+        }
+
+        // 索引节点：选择子节点；新记录小于所有键时更新首条索引的键
+        int slot = find_extent_slot(ext, header->entries, new_ext.logical);
+        if (slot < 0) {
+            slot = 0;
+            ext[0].logical = new_ext.logical;
+            if (node_block != 0) flush_meta_block(node_block);
+        }
+        uint32_t child = ext[slot].physical;
+
+        // 子节点已满：先对半分裂，将后一半移到新的兄弟块
+        ExtentHeader* child_header = node_header(child);
+        if (child_header == nullptr) return false;
+        if (child_header->entries >= EXTENT_NODE_MAX) {
+            std::vector<char> copy((char*)child_header, (char*)child_header + BLOCK_SIZE);
+            ExtentHeader* copy_header = (ExtentHeader*)copy.data();
+            Extent* copy_ext = (Extent*)(copy_header + 1);
+            int half = copy_header->entries / 2;
+
+            int sibling = alloc_block();
+            if (sibling == -1) return false;
+            char* sibling_data = get_meta_block(sibling, true);
+            if (sibling_data == nullptr) return false;
+            ExtentHeader* sibling_header = (ExtentHeader*)sibling_data;
+            sibling_header->depth = copy_header->depth;
+            sibling_header->entries = copy_header->entries - half;
+            memcpy(sibling_header + 1, copy_ext + half, sibling_header->entries * sizeof(Extent));
+            flush_meta_block(sibling);
+
+            child_header = node_header(child);
+            if (child_header == nullptr) return false;
+            child_header->entries = half;
+            flush_meta_block(child);
+
+            // 在父节点slot之后插入指向兄弟块的索引记录
+            header = node_header(node_block);
+            if (header == nullptr) return false;
+            ext = (Extent*)(header + 1);
+            memmove(ext + slot + 2, ext + slot + 1, (header->entries - slot - 1) * sizeof(Extent));
+            ext[slot + 1].logical = copy_ext[half].logical;
+            ext[slot + 1].physical = (uint32_t)sibling;
+            ext[slot + 1].length = 0;
+            header->entries++;
+            if (node_block != 0) flush_meta_block(node_block);
+
+            if (new_ext.logical >= copy_ext[half].logical) child = (uint32_t)sibling;
+        }
+        node_block = child;
+    }
+}
+
+/**
+ * @brief 在extent树中解除一个逻辑块的映射，并释放对应的数据块
+ * @param inode 文件的inode（树根可能被修改，调用者负责写回）
+ * @param block_idx 逻辑块号
+ * @return 成功解除返回true；未映射，或该块位于某段extent中间（需要拆分记录）时返回false
+ * 用于释放文件末块（尾部打包），末块总是某段extent的最后一块；
+ * 记录缩短为0时从叶子中删除，空叶子保留在树中（查找时视为未映射）
+ */
+bool DiskFS::extent_unmap(Inode& inode, uint32_t block_idx)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    // 1. 自根向下查找叶子节点
+    ExtentHeader* header = (ExtentHeader*)inode.blocks;
+    Extent* ext = (Extent*)(header + 1);
+    uint32_t leaf_block = 0;
+    while (header->depth > 0) {
+        int slot = find_extent_slot(ext, header->entries, block_idx);
+        leaf_block = ext[slot < 0 ? 0 : slot].physical;
+        char* data = get_meta_block(leaf_block);
+        if (data == nullptr) return false;
+        header = (ExtentHeader*)data;
+        ext = (Extent*)(header + 1);
+    }
+
+    // 2. 定位覆盖block_idx的extent，只处理首块或末块
+    int slot = find_extent_slot(ext, header->entries, block_idx);
+    if (slot < 0 || block_idx >= ext[slot].logical + ext[slot].length) return false;
+    Extent& e = ext[slot];
+    uint32_t block_num = e.physical + (block_idx - e.logical);
+    if (block_idx == e.logical + e.length - 1) {
+        e.length--;                       // 末块：缩短extent
+    } else if (block_idx == e.logical) {
+        e.logical++;                      // 首块：起点后移（父节点中的索引键仍不大于新起点）
+        e.physical++;
+        e.length--;
+    } else {
+        return false;
+    }
+
+    // 3. 长度为0的记录从叶子中删除
+    if (e.length == 0) {
+        memmove(ext + slot, ext + slot + 1, (header->entries - slot - 1) * sizeof(Extent));
+        header->entries--;
+    }
+    if (leaf_block != 0) flush_meta_block(leaf_block);
+    set_block_bitmap(block_num, false);
+    return true;
+}
+
+/**
+ * @brief 递归释放一个extent树块及其映射的所有数据块
+ * @param block_num 树块的块号
+ */
+void DiskFS::extent_free_node(uint32_t block_num)
+{
+    std::lock_guard<std::recursive_mutex> meta_lock(meta_mutex);
+    char* data = get_meta_block(block_num);
+    if (data != nullptr) {
+        // 先复制节点内容（递归释放过程中缓存可能淘汰该块）
+        ExtentHeader header = *(ExtentHeader*)data;
+        std::vector<Extent> entries((Extent*)(data + sizeof(ExtentHeader)),
+                                    (Extent*)(data + sizeof(ExtentHeader)) + header.entries);
+        for (const Extent& e : entries) {
+            if (header.depth > 0) {
+                extent_free_node(e.physical);
+            } else {
+                for (uint32_t i = 0; i < e.length; i++) set_block_bitmap(e.physical + i, false);
+            }
+        }
+    }
+    drop_meta_block(block_num);
+    set_block_bitmap(block_num, false);
+}
+
+/**
+ * @brief 释放extent树映射的所有数据块和树块，并将树根重置为空叶子
+ * @param inode 文件的inode（调用者负责写回）
+ */
+void DiskFS::extent_free(Inode& inode)
+{
+    ExtentHeader* root = (ExtentHeader*)inode.blocks;
+    Extent* ext = (Extent*)(root + 1);
+    for (int i = 0; i < root->entries; i++) {
+        if (root->depth > 0) {
+            extent_free_node(ext[i].physical);
+        } else {
+            for (uint32_t j = 0; j < ext[i].length; j++) set_block_bitmap(ext[i].physical + j, false);
+        }
+    }
+    memset(inode.blocks, 0, sizeof(inode.blocks));
+}
@@ -4,53 +4,56 @@
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <functional>
 
 /**
- * @brief 创建文件：分配inode并在根目录中添加目录项
- * @param name 文件名（最大长度为MAX_FILENAME-1，含终止符）
+ * @brief 创建文件：分配inode并在所在目录中添加目录项
+ * @param name 文件路径（父目录必须已存在；文件名最大长度为MAX_FILENAME-1，含终止符）
  * @return 成功返回新文件的inode编号；失败返回-1（已存在/无空闲inode/未挂载等）
  */
 int DiskFS::create_file(const std::string& name)
 {
-    // 前置条件检查：磁盘已挂载，文件名长度合法（不含终止符不超过MAX_FILENAME-1）
-    if (!isMounted() || name.empty() || name.length() >= MAX_FILENAME) 
+    // 前置条件检查：磁盘已挂载，父目录存在，文件名长度合法（不含终止符不超过MAX_FILENAME-1）
+    std::lock_guard<SharedMutex> ns_lock(namespace_mutex);
+    std::string leaf;
+    int parent = isMounted() ? resolve_parent(name, leaf) : -1;
+    if (parent == -1 || leaf.empty() || leaf.length() >= MAX_FILENAME) 
     {
-        std::cerr << "创建文件失败：磁盘未挂载或文件名无效" << std::endl;
+        std::cerr << "创建文件失败：磁盘未挂载、父目录不存在或文件名无效" << std::endl;
         return -1;
     }
 
-    // 清除文件流错误状态，避免之前的错误影响当前操作
-    disk_file.clear();
-
-    // 检查文件是否已存在（遍历根目录目录项）
-    std::vector<DirEntry> dir_list = list_files();
-    for (const auto& entry : dir_list) 
+    // 检查文件是否已存在（经目录项缓存查询所在目录）
+    if (dentry_lookup((uint32_t)parent, leaf) != -1)
     {
-        if (entry.valid && name == entry.name) 
-        {
-            std::cerr << "创建文件失败：" << name << " 已存在" << std::endl;
-            return -1;
-        }
-    }
-
-    // 读取根目录inode（0号inode），并检查读取结果
-    Inode root_inode;
-    disk_file.seekg(get_inode_pos(0));
-    disk_file.read((char*)&root_inode, sizeof(Inode));
-
-    if (disk_file.fail() || root_inode.type != 2) {  // 检查读取失败或类型错误
-        std::cerr << "创建文件失败：根目录inode无效" << std::endl;
+        std::cerr << "创建文件失败：" << name << " 已存在" << std::endl;
         return -1;
     }
 
-    // 检查根目录数据块是否有效（至少分配了一个块）
-    if (root_inode.blocks[0] == 0)
-    {  // 假设0表示未分配块
-        std::cerr << "创建文件失败：根目录数据块未分配" << std::endl;
-        return -1;
+    int inode_num = new_file((uint32_t)parent, leaf, true);
+    if (inode_num != -1) {
+        std::cout << "文件 " << name << " 创建成功，inode：" << inode_num << std::endl;
     }
+    return inode_num;
+}
+
+/**
+ * @brief 在目录中新建空文件（调用者独占持有目录锁，并已确认文件名不存在）
+ * @param parent 所在目录的inode编号
+ * @param leaf 文件名
+ * @param update_parent 是否检查并更新所在目录的inode（修改时间）；
+ *        为false时由调用者事先检查目录、事后统一更新一次（批量创建）
+ * @return 成功返回新文件的inode编号；失败返回-1
+ */
+int DiskFS::new_file(uint32_t parent, const std::string& leaf, bool update_parent)
+{
+    // 读取所在目录的inode，并检查读取结果
+    Inode dir_inode;
+    if (update_parent && !valid_dir_inode(parent, dir_inode)) return -1;
 
-    // 分配空闲inode
+    // 分配空闲inode（查找空闲inode至标记位图期间持有分配器锁，避免两个线程取得同一inode）
+    std::unique_lock<std::recursive_mutex> alloc_lock(alloc_mutex);
     int inode_num = find_free_inode();
     if (inode_num == -1) {
         std::cerr << "创建文件失败：无空闲inode" << std::endl;
@@ -66,87 +69,102 @@ int DiskFS::create_file(const std::string& name)
     new_inode.create_time = now;
     new_inode.modify_time = now;
     new_inode.size = 0;  // 初始大小为0
+    if (mount_options.extents) {
+        new_inode.flags |= INODE_FLAG_EXTENTS;  // 按挂载选项使用extent树映射（全0的blocks区域即空树根）
+    }
 
     // 写入新inode到磁盘，并检查操作结果
-    disk_file.seekp(get_inode_pos(inode_num));
-    disk_file.write((char*)&new_inode, sizeof(Inode));
-    if (disk_file.fail()) {
+    new_inode.inode_num = inode_num;
+    if (!write_inode(inode_num, new_inode)) {
         std::cerr << "创建文件失败：写入inode " << inode_num << " 失败" << std::endl;
         return -1;  // 写入失败，不标记位图，避免inode泄露
     }
     set_inode_bitmap(inode_num, true);  // 写入成功后再标记位图
+    alloc_lock.unlock();
 
-    // 读取根目录数据块（简化设计：根目录仅使用1个块）
-    char buffer[BLOCK_SIZE];
-    if (!read_block(root_inode.blocks[0], buffer)) {
-        std::cerr << "创建文件失败：读取根目录数据块失败" << std::endl;
+    // 在所在目录中添加目录项（失败原因由dir_add输出）
+    if (!dir_add((uint32_t)parent, leaf, inode_num, 1)) {
         // 回滚：删除已分配的inode（标记为未使用）
         set_inode_bitmap(inode_num, false);
         return -1;
     }
 
-    // 寻找根目录中第一个空闲目录项（跳过0号的"."）
-    DirEntry* dir_entries = (DirEntry*)buffer;
-    size_t dir_entry_count = BLOCK_SIZE / sizeof(DirEntry);
-    size_t free_index = dir_entry_count;  // 初始化为无效索引
-    for (size_t i = 1; i < dir_entry_count; i++) {
-        if (!dir_entries[i].valid) {
-            free_index = i;
-            break;
-        }
-    }
-    if (free_index == dir_entry_count) {  // 无空闲目录项
-        std::cerr << "创建文件失败：根目录已满，无空闲目录项" << std::endl;
-        // 回滚：删除已分配的inode
-        set_inode_bitmap(inode_num, false);
-        return -1;
-    }
-
-    // 填充空闲目录项
-    strncpy(dir_entries[free_index].name, name.c_str(), MAX_FILENAME - 1);
-    dir_entries[free_index].name[MAX_FILENAME - 1] = '\0';  // 确保终止符
-    dir_entries[free_index].inode_num = inode_num;
-    dir_entries[free_index].valid = 1;
+    if (update_parent) touch_dir(parent, now);
+    return inode_num;
+}
 
-    // 写回根目录数据块，并检查结果
-    if (!write_block(root_inode.blocks[0], buffer)) {
-        std::cerr << "创建文件失败：写回根目录数据块失败" << std::endl;
-        // 回滚：删除inode和目录项（目录项未写入，仅需回滚inode）
-        set_inode_bitmap(inode_num, false);
-        return -1;
+/**
+ * @brief 读取并检查文件所在目录的inode（创建文件前调用）
+ * @param parent 目录的inode编号
+ * @param dir_inode 输出参数：目录的inode
+ * @return 是有效的目录返回true
+ */
+bool DiskFS::valid_dir_inode(uint32_t parent, Inode& dir_inode)
+{
+    if (!read_inode(parent, dir_inode) || dir_inode.type != 2) {  // 检查读取失败或类型错误
+        std::cerr << "创建文件失败：目录inode无效" << std::endl;
+        return false;
     }
 
-    // 更新根目录inode的修改时间，并写回磁盘
-    root_inode.modify_time = now;
-    disk_file.seekp(get_inode_pos(0));
-    disk_file.write((char*)&root_inode, sizeof(Inode));
-    if (disk_file.fail()) {
-        std::cerr << "警告：根目录修改时间更新失败，但文件已创建" << std::endl;
-        // 此处不返回-1，因为文件已成功创建，仅元数据有小问题
+    // 检查目录数据块是否有效（至少分配了一个块）
+    if (dir_inode.blocks[0] == 0)
+    {  // 假设0表示未分配块
+        std::cerr << "创建文件失败：目录数据块未分配" << std::endl;
+        return false;
     }
+    return true;
+}
 
-    std::cout << "文件 " << name << " 创建成功，inode：" << inode_num << std::endl;
-    return inode_num;
+/**
+ * @brief 更新目录inode的修改时间，并写回磁盘（lazytime下仅暂存在内存中）
+ * @param parent 目录的inode编号
+ * @param now 修改时间
+ * 目录扩展时dir_add已改写目录inode，需重新读取
+ */
+void DiskFS::touch_dir(uint32_t parent, time_t now)
+{
+    Inode dir_inode;
+    if (!read_inode(parent, dir_inode)) {
+        std::cerr << "警告：目录修改时间更新失败，但文件已创建" << std::endl;
+        return;
+    }
+    Inode dir_orig = dir_inode;
+    dir_inode.modify_time = now;
+    if (!update_inode(parent, dir_inode, dir_orig)) {
+        std::cerr << "警告：目录修改时间更新失败，但文件已创建" << std::endl;
+        // 文件已成功创建，仅元数据有小问题
+    }
 }
 
 /**
- * @brief 打开文件：根据文件名查找对应的inode编号
- * @param name 目标文件名
- * @return 成功返回文件的inode编号；失败返回-1（文件不存在或未挂载）
+ * @brief 打开文件：根据文件路径查找对应的inode编号
+ * @param name 目标文件路径
+ * @return 成功返回文件的inode编号；失败返回-1（文件不存在、是目录或未挂载）
  * 打开文件本质是通过文件名找到inode，后续操作通过inode编号进行
  */
 int DiskFS::open_file(const std::string& name) {
     if (!isMounted()) return -1;  // 未挂载则无法操作
+    SharedLock ns_lock(namespace_mutex);
 
-    // 获取根目录中的所有文件条目
-    std::vector<DirEntry> entries = list_files();
-    // 遍历目录项，寻找文件名匹配且有效的条目
-    for (const auto& entry : entries) {
-        if (entry.valid && name == entry.name) {
-            return entry.inode_num;  // 返回对应的inode编号
-        }
-    }
-    return -1;  // 未找到文件
+    return lookup_file(name);
+}
+
+/**
+ * @brief 按路径查找文件的inode编号（调用者持有目录锁）
+ * @param name 文件路径
+ * @return 文件的inode编号；不存在或是目录返回-1
+ */
+int DiskFS::lookup_file(const std::string& name)
+{
+    // 逐级经目录项缓存查找（不读取目录块，也不复制文件名；不存在的结果同样被缓存）
+    const char* leaf = name.data();
+    size_t leaf_len = 0, entered = 0;
+    int parent = resolve_parent(name.data(), name.size(), leaf, leaf_len, entered);
+    if (parent == -1 || leaf_len == 0) return -1;
+    uint8_t type = 0;
+    int inode_num = dentry_lookup((uint32_t)parent, leaf, leaf_len, &type);
+    if (type == 2) return -1;  // 目录不能作为文件打开
+    return inode_num;
 }
 
 /**
@@ -158,52 +176,95 @@ int DiskFS::open_file(const std::string& name) {
  * @return 成功返回实际读取的字节数；0表示已到文件末尾；-1表示失败（参数无效等）
  */
 int DiskFS::read_file(int inode_num, char* buffer, size_t size, off_t offset) {
-    // 检查前置条件：磁盘已挂载，inode编号有效
-    if (!isMounted() || inode_num < 0 || (uint32_t)inode_num >= super_block.total_inodes) 
+    // 检查前置条件：磁盘已挂载，inode编号有效（编号上限由read_inode检查）
+    if (!isMounted() || inode_num < 0) 
         return -1;
+    SharedLock lock(inode_lock(inode_num));
+    return read_file_data(inode_num, buffer, size, offset);
+}
+
+/**
+ * @brief 按路径读取整个文件
+ * @param name 文件路径
+ * @param content 输出参数：文件内容
+ * @return 成功返回读取的字节数；文件不存在、是目录或读取失败返回-1
+ * 在共享持有目录锁期间查找文件并取得其inode锁后才释放目录锁：
+ * 删除文件须先独占持有目录锁、再独占持有inode锁，因此读取期间文件不会被删除，其inode编号也不会被新文件复用
+ */
+int DiskFS::read_path(const std::string& name, std::string& content)
+{
+    if (!isMounted()) return -1;
+    SharedLock ns_lock(namespace_mutex);
+    int inode_num = lookup_file(name);
+    if (inode_num == -1) return -1;
+    SharedLock lock(inode_lock((uint32_t)inode_num));
+    ns_lock.unlock();
 
+    Inode inode;
+    if (!read_inode((uint32_t)inode_num, inode)) return -1;
+    content.resize(inode.size);
+    if (inode.size == 0) return 0;
+    int bytes_read = read_file_data(inode_num, &content[0], inode.size, 0);
+    content.resize(bytes_read < 0 ? 0 : bytes_read);
+    return bytes_read;
+}
+
+/**
+ * @brief 读取文件内容（调用者共享持有该文件的inode锁）
+ */
+int DiskFS::read_file_data(int inode_num, char* buffer, size_t size, off_t offset) {
     // 读取目标文件的inode信息
     Inode inode;
-    disk_file.seekg(get_inode_pos(inode_num));
-    disk_file.read((char*)&inode, sizeof(Inode));
+    if (!read_inode(inode_num, inode)) return -1;
     // 检查inode状态：必须是已使用的普通文件（类型1）
     if (!inode.used || inode.type != 1) return -1;
 
     // 计算实际可读取的字节数（不能超过文件大小 - 偏移量）
+    if (offset < 0 || (uint32_t)offset >= inode.size) return 0;  // 偏移量已超出文件大小，无数据可读
     size_t max_read = inode.size - offset;
-    if (max_read <= 0) return 0;  // 偏移量已超出文件大小，无数据可读
     size_t read_size = std::min(size, max_read);  // 取期望大小和最大可读取的较小值
 
     if (read_size == 0) return 0;  // 无需读取
 
+    // 内联文件：数据直接位于inode中，无需块IO
+    if (inode.flags & INODE_FLAG_INLINE) {
+        memcpy(buffer, (char*)inode.blocks + offset, read_size);
+        return read_size;
+    }
+
     // 读取数据：按块读取，处理跨块情况
     char block_buffer[BLOCK_SIZE];  // 临时存储块数据的缓冲区
     size_t bytes_read = 0;          // 已读取的总字节数
     off_t current_offset = offset;  // 当前读取偏移量
 
+    uint32_t tail_idx = (inode.flags & INODE_FLAG_TAIL) ? inode.size / BLOCK_SIZE : UINT32_MAX;  // 尾部所在逻辑块
+
     while (bytes_read < read_size) {
-        // 计算当前偏移量所在的块索引（inode的blocks数组下标）
+        // 计算当前偏移量所在的逻辑块号，以及块内偏移和本块可读取的字节数
         uint32_t block_idx = current_offset / BLOCK_SIZE;
-        // 若块索引超出inode的块指针范围（最多16个块），读取失败
-        if (block_idx >= 16) break;
-
-        uint32_t block_num = inode.blocks[block_idx];  // 数据块编号
-        // 若块编号无效（未分配），读取失败
-        if (block_num == 0) break;
-
-        // 读取该数据块到临时缓冲区
-        if (!read_block(block_num, block_buffer)) return -1;
-
-        // 计算在块内的偏移量（当前偏移量 % 块大小）
         off_t in_block_offset = current_offset % BLOCK_SIZE;
-        // 计算当前块可读取的字节数（块内剩余空间 vs 剩余需读取的字节数）
         size_t read_from_block = std::min(
             (size_t)(BLOCK_SIZE - in_block_offset),  // 块内剩余空间
             read_size - bytes_read                   // 还需读取的字节数
         );
 
-        // 从块缓冲区复制数据到用户缓冲区
-        memcpy(buffer + bytes_read, block_buffer + in_block_offset, read_from_block);
+        if (block_idx == tail_idx) {
+            // 尾部位于共享块中：只读取所需的字节，而不是整个块
+            uint32_t pos = inode.tail_block * BLOCK_SIZE + inode.tail_offset + in_block_offset;
+            if (!read_bytes(pos, buffer + bytes_read, read_from_block)) return -1;
+        } else {
+            // 将逻辑块映射为磁盘块号（直接块/间接块/extent）
+            uint32_t block_num = bmap(inode, block_idx, false);
+            if (block_num == 0) {
+                // 文件空洞（未分配的块）按全0读取
+                memset(block_buffer, 0, BLOCK_SIZE);
+            } else if (!read_block(block_num, block_buffer)) {
+                return -1;  // 读取该数据块到临时缓冲区失败
+            }
+            // 从块缓冲区复制数据到用户缓冲区
+            memcpy(buffer + bytes_read, block_buffer + in_block_offset, read_from_block);
+        }
+
         bytes_read += read_from_block;       // 更新已读取字节数
         current_offset += read_from_block;   // 更新当前偏移量
     }
@@ -212,45 +273,36 @@ int DiskFS::read_file(int inode_num, char* buffer, size_t size, off_t offset) {
 }
 
 /**
- * @brief 写入文件内容
- * @param inode_num 目标文件的inode编号
+ * @brief 判断一段内存是否全为0
+ */
+static bool is_zero_filled(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] != 0) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 按块写入文件数据（内部使用，处理跨块和新块分配）
+ * @param inode 文件的inode（块映射可能被修改，调用者负责写回）
  * @param buffer 存储待写入数据的缓冲区
  * @param size 待写入的字节数
- * @param offset 写入的起始偏移量（从文件开头计算，单位：字节）
- * @return 成功返回实际写入的字节数；-1表示失败（参数无效等）
+ * @param offset 写入的起始偏移量
+ * @return 成功返回实际写入的字节数（空间不足时可能小于size）；-1表示IO失败
  */
-int DiskFS::write_file(int inode_num, const char* buffer, size_t size, off_t offset) {
-    // 检查前置条件：磁盘已挂载，inode编号有效，缓冲区非空且有数据可写
-    if (!isMounted() || inode_num < 0 || (uint32_t)inode_num >= super_block.total_inodes || 
-        buffer == nullptr || size == 0) 
-        return -1;
-
-    // 读取目标文件的inode信息
-    Inode inode;
-    disk_file.seekg(get_inode_pos(inode_num));
-    disk_file.read((char*)&inode, sizeof(Inode));
-    // 检查inode状态：必须是已使用的普通文件（类型1）
-    if (!inode.used || inode.type != 1) return -1;
-
-    // 写入数据：按块写入，处理跨块和新块分配
+int DiskFS::write_blocks(Inode& inode, const char* buffer, size_t size, off_t offset) {
     char block_buffer[BLOCK_SIZE];  // 临时存储块数据的缓冲区
     size_t bytes_written = 0;       // 已写入的总字节数
     off_t current_offset = offset;  // 当前写入偏移量
-    time_t now = time(nullptr);     // 当前时间（用于更新修改时间）
 
     while (bytes_written < size) {
-        // 计算当前偏移量所在的块索引（inode的blocks数组下标）
+        // 计算当前偏移量所在的逻辑块号，映射为磁盘块号（未分配时分配新块及所需的间接块）
         uint32_t block_idx = current_offset / BLOCK_SIZE;
-        // 若块索引超出最大支持的块数（16个），无法写入（简化设计，不支持间接块）
-        if (block_idx >= 16) break;
-
-        int block_num = inode.blocks[block_idx];  // 数据块编号
-        // 若块未分配，尝试分配新块
-        if (block_num == 0) {
-            block_num = find_free_block();  // 查找空闲块
-            if (block_num == -1) break;     // 无空闲块，写入失败
-            inode.blocks[block_idx] = (uint32_t)block_num;  // 更新inode的块指针
-            set_block_bitmap(block_num, true);    // 标记块为已使用
+        bool is_new = false;
+        uint32_t block_num = bmap(inode, block_idx, true, &is_new);
+        if (block_num == 0) break;  // 无空闲块或超出寻址范围，写入终止
+
+        if (is_new) {
             // 初始化新块为0（避免残留数据）
             memset(block_buffer, 0, BLOCK_SIZE);
         } else {
@@ -275,119 +327,445 @@ int DiskFS::write_file(int inode_num, const char* buffer, size_t size, off_t off
         current_offset += write_to_block;  // 更新当前偏移量
     }
 
+    return bytes_written;
+}
+
+/**
+ * @brief 写入文件内容
+ * @param inode_num 目标文件的inode编号
+ * @param buffer 存储待写入数据的缓冲区
+ * @param size 待写入的字节数
+ * @param offset 写入的起始偏移量（从文件开头计算，单位：字节）
+ * @return 成功返回实际写入的字节数；-1表示失败（参数无效等）
+ * 写入后不超过INLINE_DATA_SIZE的小文件直接内联存放在inode中，不分配数据块；
+ * 内联文件增长超出该大小时，先将已有内容迁移到数据块，再按块写入
+ */
+int DiskFS::write_file(int inode_num, const char* buffer, size_t size, off_t offset) {
+    // 检查前置条件：磁盘已挂载，inode编号有效，缓冲区非空且有数据可写
+    if (!isMounted() || inode_num < 0 || buffer == nullptr || size == 0 || offset < 0) 
+        return -1;
+    std::lock_guard<SharedMutex> lock(inode_lock(inode_num));
+    return write_file_data(inode_num, buffer, size, offset);
+}
+
+/**
+ * @brief 按路径写入文件
+ * @param name 文件路径
+ * @param buffer 存储待写入数据的缓冲区
+ * @param size 待写入的字节数（为0时只打开或创建文件）
+ * @param offset 写入的起始偏移量
+ * @param flags OPEN_CREATE：文件不存在时创建；OPEN_EXCL（与OPEN_CREATE同用）：文件已存在时失败
+ * @return 成功返回实际写入的字节数；文件不存在（且不创建）、已存在（OPEN_EXCL）或写入失败返回-1
+ * 与read_path相同，在持有目录锁期间取得inode锁，写入期间文件不会被删除或复用；
+ * 文件存在时只共享持有目录锁；需要创建时改为独占持有目录锁，重新查找后创建，创建与取得inode锁之间没有间隙
+ */
+int DiskFS::write_path(const std::string& name, const char* buffer, size_t size, off_t offset, int flags)
+{
+    if (!isMounted() || (buffer == nullptr && size > 0) || offset < 0) return -1;
+    if (!(flags & OPEN_EXCL)) {
+        SharedLock ns_lock(namespace_mutex);
+        int inode_num = lookup_file(name);
+        if (inode_num != -1) {
+            std::lock_guard<SharedMutex> lock(inode_lock((uint32_t)inode_num));
+            ns_lock.unlock();
+            return size == 0 ? 0 : write_file_data(inode_num, buffer, size, offset);
+        }
+        if (!(flags & OPEN_CREATE)) return -1;
+    }
+
+    // 创建文件：独占持有目录锁后重新查找（释放共享锁期间可能已被其他线程创建）
+    std::unique_lock<SharedMutex> ns_lock(namespace_mutex);
+    std::string leaf;
+    int parent = resolve_parent(name, leaf);
+    if (parent == -1 || leaf.empty() || leaf.length() >= MAX_FILENAME) return -1;
+    uint8_t type = 0;
+    int inode_num = dentry_lookup((uint32_t)parent, leaf, &type);
+    if (inode_num != -1 && ((flags & OPEN_EXCL) || type == 2)) return -1;
+    if (inode_num == -1) {
+        inode_num = new_file((uint32_t)parent, leaf, true);
+        if (inode_num == -1) return -1;
+    }
+    std::lock_guard<SharedMutex> lock(inode_lock((uint32_t)inode_num));
+    ns_lock.unlock();
+    return size == 0 ? 0 : write_file_data(inode_num, buffer, size, offset);
+}
+
+/**
+ * @brief 批量写入或创建同一目录下的多个文件
+ * @param dir 所在目录的路径
+ * @param items 各文件的写入请求，按顺序执行，结果写回各项
+ * @return 目录存在（各项结果见items）返回true；未挂载或目录不存在返回false
+ * 目录只解析一次，查找期间持有目录锁：文件均已存在时只共享持有，
+ * 否则独占持有，依次创建缺少的文件后只更新一次目录的修改时间；
+ * 与write_path相同，在持有目录锁期间取得全部文件的inode锁（按地址排序、去重）后即释放目录锁，
+ * 写入期间不阻塞其他线程的路径查找与目录项增删
+ */
+bool DiskFS::write_batch(const std::string& dir, std::vector<BatchWrite>& items)
+{
+    if (!isMounted()) return false;
+    for (auto& item : items) {
+        item.inode_num = -1;
+        item.created = false;
+        item.result = -1;
+    }
+
+    // 查找全部文件，create为true时创建缺少的文件；返回是否全部找到（或已创建）
+    auto lookup_all = [&](uint32_t parent, bool create) {
+        bool found = true;
+        Inode dir_inode;
+        bool dir_checked = false, dir_valid = false;
+        time_t now = time(nullptr);
+        for (auto& item : items) {
+            if (item.name.empty() || item.name.length() >= MAX_FILENAME || item.name.find('/') != std::string::npos) continue;
+            uint8_t type = 0;
+            item.inode_num = dentry_lookup(parent, item.name, &type);
+            if (type == 2) {
+                item.inode_num = -1;  // 目录不能作为文件写入
+                continue;
+            }
+            if (item.inode_num != -1) continue;
+            if (!create) {
+                found = false;
+                break;
+            }
+            if (!dir_checked) {
+                dir_valid = valid_dir_inode(parent, dir_inode);
+                dir_checked = true;
+            }
+            if (!dir_valid) continue;
+            item.inode_num = new_file(parent, item.name, false);
+            item.created = item.inode_num != -1;
+        }
+        for (auto& item : items) {
+            if (item.created) {
+                touch_dir(parent, now);
+                break;
+            }
+        }
+        return found;
+    };
+
+    // 持有目录锁期间取得全部文件的inode锁（同一文件或同一分片只加锁一次，按地址顺序避免互相等待），
+    // 文件不会在查找与写入之间被删除
+    auto lock_all = [&](std::vector<std::unique_lock<SharedMutex>>& locks) {
+        std::vector<SharedMutex*> mutexes;
+        for (const auto& item : items) {
+            if (item.inode_num != -1) mutexes.push_back(&inode_lock((uint32_t)item.inode_num));
+        }
+        std::sort(mutexes.begin(), mutexes.end(), std::less<SharedMutex*>());
+        mutexes.erase(std::unique(mutexes.begin(), mutexes.end()), mutexes.end());
+        for (SharedMutex* mutex : mutexes) locks.emplace_back(*mutex);
+    };
+
+    // 依次写入（调用者已持有各文件的inode锁）
+    auto write_all = [&]() {
+        for (auto& item : items) {
+            if (item.inode_num == -1) continue;
+            item.result = item.touch || item.size == 0 ? 0 : write_file_data(item.inode_num, item.data, item.size, 0);
+        }
+    };
+
+    std::vector<std::unique_lock<SharedMutex>> locks;
+    {
+        SharedLock ns_lock(namespace_mutex);
+        int parent = resolve_path(dir);
+        if (parent == -1 || get_dir((uint32_t)parent) == nullptr) return false;
+        if (lookup_all((uint32_t)parent, false)) {
+            lock_all(locks);
+            ns_lock.unlock();
+            write_all();
+            return true;
+        }
+    }
+
+    std::unique_lock<SharedMutex> ns_lock(namespace_mutex);
+    int parent = resolve_path(dir);
+    if (parent == -1 || get_dir((uint32_t)parent) == nullptr) return false;
+    lookup_all((uint32_t)parent, true);
+    lock_all(locks);
+    ns_lock.unlock();
+    write_all();
+    return true;
+}
+
+/**
+ * @brief 写入文件内容（调用者独占持有该文件的inode锁）
+ */
+int DiskFS::write_file_data(int inode_num, const char* buffer, size_t size, off_t offset) {
+    // 读取目标文件的inode信息
+    Inode inode;
+    if (!read_inode(inode_num, inode)) return -1;
+    // 检查inode状态：必须是已使用的普通文件（类型1）
+    if (!inode.used || inode.type != 1) return -1;
+    const Inode orig = inode;  // 修改前的inode（用于判断是否仅修改时间变化）
+
+    time_t now = time(nullptr);     // 当前时间（用于更新修改时间）
+    char* inline_data = (char*)inode.blocks;  // 内联数据区（blocks起至inode末尾）
+    bool is_inline = (inode.flags & INODE_FLAG_INLINE) != 0;
+
+    // 1. 内联写入：文件已内联，或尚未占用任何数据块（映射区全0），且写入后仍能放入inode
+    if (offset + size <= (size_t)INLINE_DATA_SIZE &&
+        (is_inline || (inode.size == 0 && is_zero_filled(inline_data, INLINE_DATA_SIZE)))) {
+        memcpy(inline_data + offset, buffer, size);
+        inode.flags |= INODE_FLAG_INLINE;
+        if (offset + size > inode.size) {
+            inode.size = offset + size;
+        }
+        inode.modify_time = now;
+        if (!update_inode(inode_num, inode, orig)) return -1;
+        return size;
+    }
+
+    uint32_t old_size = inode.size;
+    uint32_t end = offset + size;
+    uint32_t new_size = std::max(old_size, end);
+
+    // 2. 文件大小不变（覆盖写）：数据块与共享块中的尾部均原地写入，尾部位置不变，不重新打包
+    if (!is_inline && new_size == old_size) {
+        bool has_tail = (inode.flags & INODE_FLAG_TAIL) != 0;
+        uint32_t tail_start = has_tail ? old_size / BLOCK_SIZE * BLOCK_SIZE : old_size;
+        uint32_t below = (uint32_t)offset < tail_start ? std::min(end, tail_start) - offset : 0;
+        int bytes_written = below > 0 ? write_blocks(inode, buffer, below, offset) : 0;
+        if (bytes_written < 0) return -1;
+        if ((uint32_t)bytes_written == below && end > tail_start) {
+            uint32_t from = std::max((uint32_t)offset, tail_start);
+            uint32_t pos = inode.tail_block * BLOCK_SIZE + inode.tail_offset + (from - tail_start);
+            if (write_bytes(pos, buffer + (from - offset), end - from)) bytes_written = size;
+        }
+        if (bytes_written == 0) return -1;
+        inode.modify_time = now;
+        update_inode(inode_num, inode, orig);  // 只有修改时间变化时lazytime下暂存在内存中
+        return bytes_written;
+    }
+
+    // 3. 取出不在数据块中的旧内容（内联数据或共享块中的尾部），写入后按新的布局重新存放
+    //    旧尾部片段在新的inode写回后才释放：此前失败时恢复inode中的尾部引用，片段不会被其他文件占用
+    char pending[BLOCK_SIZE];    // 旧内容
+    uint32_t pending_start = 0;  // 旧内容在文件中的起始偏移
+    uint32_t pending_len = 0;    // 旧内容长度（0表示无需保留）
+    bool old_tail = false;       // 旧内容是否来自共享尾部块（orig中记录其位置）
+    if (is_inline) {
+        // 内联文件超出inode容量：清空内联区（全0即空映射）
+        pending_len = old_size;
+        memcpy(pending, inline_data, old_size);
+        memset(inline_data, 0, INLINE_DATA_SIZE);
+        inode.flags &= ~INODE_FLAG_INLINE;
+    } else if (inode.flags & INODE_FLAG_TAIL) {
+        pending_start = old_size / BLOCK_SIZE * BLOCK_SIZE;
+        pending_len = old_size - pending_start;
+        if (!read_tail(inode, pending)) return -1;
+        inode.flags &= ~INODE_FLAG_TAIL;
+        inode.tail_block = 0;
+        inode.tail_offset = 0;
+        old_tail = true;
+    }
+    // 失败时保存已分配的块（避免块泄露），并恢复对旧尾部片段的引用（文件大小尚未改变）
+    auto fail = [&]() {
+        if (old_tail) {
+            inode.flags |= INODE_FLAG_TAIL;
+            inode.tail_block = orig.tail_block;
+            inode.tail_offset = orig.tail_offset;
+        }
+        write_inode(inode_num, inode);
+        return -1;
+    };
+    // 旧内容被本次写入完全覆盖时无需保留（如整体重写一个小文件）
+    if (pending_len > 0 && (uint32_t)offset <= pending_start && end >= pending_start + pending_len) {
+        pending_len = 0;
+    }
+
+    // 4. 判断写入后文件末尾不足一块的部分是否打包进共享尾部块
+    uint32_t tail_start = new_size / BLOCK_SIZE * BLOCK_SIZE;
+    uint32_t tail_len = new_size - tail_start;
+    bool pack = tail_len > 0 && tail_len <= (uint32_t)TAIL_PACK_MAX;
+
+    char tail_buf[BLOCK_SIZE];  // 新尾部的内容
+    if (pack) {
+        memset(tail_buf, 0, BLOCK_SIZE);
+        if (pending_len > 0 && pending_start == tail_start) {
+            // 旧内容恰好位于新尾部：直接并入
+            memcpy(tail_buf, pending, pending_len);
+            pending_len = 0;
+        } else if (old_size > tail_start) {
+            // 尾部原先位于私有数据块中：读出其有效部分
+            uint32_t block_num = bmap(inode, tail_start / BLOCK_SIZE, false);
+            if (block_num != 0) {
+                char block_buffer[BLOCK_SIZE];
+                if (!read_block(block_num, block_buffer)) return fail();
+                memcpy(tail_buf, block_buffer, old_size - tail_start);
+            }
+        }
+    }
+
+    // 5. 未并入新尾部的旧内容先写回数据块
+    if (pending_len > 0 && write_blocks(inode, pending, pending_len, pending_start) != (int)pending_len) {
+        return fail();
+    }
+
+    // 6. 写入数据：尾部打包时，尾部之前的部分按块写入，尾部存入共享块
+    int bytes_written;
+    if (pack) {
+        uint32_t below = (uint32_t)offset < tail_start ? std::min(end, tail_start) - offset : 0;
+        bytes_written = below > 0 ? write_blocks(inode, buffer, below, offset) : 0;
+        if (bytes_written < 0) return fail();
+
+        uint32_t store_len = tail_len;
+        if ((uint32_t)bytes_written < below) {
+            // 空间不足导致短写：不再写入新尾部，仅保留尾部原有的内容
+            store_len = old_size > tail_start ? old_size - tail_start : 0;
+        } else {
+            // 新数据中落在尾部的部分
+            if (end > tail_start) {
+                uint32_t from = std::max((uint32_t)offset, tail_start);
+                memcpy(tail_buf + (from - tail_start), buffer + (from - offset), end - from);
+            }
+            bytes_written = size;
+        }
+
+        if (store_len > 0) {
+            unmap_block(inode, tail_start / BLOCK_SIZE);  // 释放尾部原先占用的私有数据块
+            if (!store_tail(inode, tail_buf, store_len) &&
+                write_blocks(inode, tail_buf, store_len, tail_start) != (int)store_len) {
+                // 共享块与私有块均无法分配：尾部丢失，按短写处理
+                bytes_written = tail_start > (uint32_t)offset ? tail_start - offset : 0;
+                if (inode.size > tail_start) inode.size = tail_start;
+            }
+        }
+    } else {
+        bytes_written = write_blocks(inode, buffer, size, offset);
+        if (bytes_written < 0) return fail();
+    }
+
     // 更新文件大小（若写入超出原大小）
-    if (offset + bytes_written > inode.size) {
+    if (offset + (size_t)bytes_written > inode.size) {
         inode.size = offset + bytes_written;
     }
     // 更新文件修改时间
     inode.modify_time = now;
-    // 将更新后的inode写回磁盘
-    disk_file.seekp(get_inode_pos(inode_num));
-    disk_file.write((char*)&inode, sizeof(Inode));
+    // 将更新后的inode写回磁盘，之后才释放旧尾部片段（写回失败时磁盘上的inode仍引用旧片段，保留不释放）
+    if (update_inode(inode_num, inode, orig) && old_tail) {
+        Inode old = orig;
+        release_tail(old);
+    }
 
     return bytes_written;  // 返回实际写入的字节数
 }
 
 /**
- * @brief 删除文件：释放inode、数据块，并从根目录中移除目录项
- * @param name 目标文件名
- * @return 成功返回true；失败返回false（文件不存在/未挂载等）
+ * @brief 删除文件：释放inode、数据块，并从所在目录中移除目录项
+ * @param name 目标文件路径
+ * @return 成功返回true；失败返回false（文件不存在/是目录/未挂载等）
  */
 bool DiskFS::delete_file(const std::string& name) {
     if (!isMounted()) return false;  // 未挂载则无法操作
+    std::lock_guard<SharedMutex> ns_lock(namespace_mutex);
 
-    // 读取根目录inode（0号）
-    Inode root_inode;
-    disk_file.seekg(get_inode_pos(0));
-    disk_file.read((char*)&root_inode, sizeof(Inode));
-    if (root_inode.type != 2) return false;  // 根目录必须是目录类型
-
-    // 读取根目录数据块，查找目标文件的目录项
-    char buffer[BLOCK_SIZE];
-    if (!read_block(root_inode.blocks[0], buffer)) return false;
-    DirEntry* dir_entries = (DirEntry*)buffer;
-
-    int target_inode = -1;  // 目标文件的inode编号
-    size_t target_entry_idx = -1;  // 目标目录项在数组中的索引
-
-    // 遍历目录项，寻找文件名匹配且有效的条目
-    for (size_t i = 1; i < BLOCK_SIZE / sizeof(DirEntry); i++) {
-        if (dir_entries[i].valid && name == dir_entries[i].name) {
-            target_inode = dir_entries[i].inode_num;
-            target_entry_idx = i;
-            break;
-        }
-    }
+    // 解析所在目录并读取其inode
+    std::string leaf;
+    int parent = resolve_parent(name, leaf);
+    if (parent == -1 || leaf.empty()) return false;
+    Inode dir_inode;
+    if (!read_inode((uint32_t)parent, dir_inode) || dir_inode.type != 2) return false;  // 必须是目录类型
 
+    // 经目录项缓存查找目标文件
+    int target_inode = dentry_lookup((uint32_t)parent, leaf);
     if (target_inode == -1) return false;  // 未找到文件
 
-    // 读取目标文件的inode
+    // 读取目标文件的inode（持有其inode锁，等待进行中的读写结束）
+    std::lock_guard<SharedMutex> lock(inode_lock(target_inode));
     Inode file_inode;
-    disk_file.seekg(get_inode_pos(target_inode));
-    disk_file.read((char*)&file_inode, sizeof(Inode));
+    if (!read_inode(target_inode, file_inode)) return false;
     if (!file_inode.used || file_inode.type != 1) return false;  // 必须是已使用的文件
 
-    // 释放文件占用的数据块（遍历inode的块指针）
-    for (uint32_t i = 0; i < 16; i++) {
-        uint32_t block_num = file_inode.blocks[i];
-        if (block_num != 0) {
-            set_block_bitmap(block_num, false);  // 标记块为空闲
-            file_inode.blocks[i] = 0;  // 清空块指针
-        }
-    }
+    // 释放文件占用的数据块（直接块、间接块及其指向的块）
+    free_file_blocks(file_inode);
 
     // 标记inode为未使用
     file_inode.used = 0;
-    disk_file.seekp(get_inode_pos(target_inode));
-    disk_file.write((char*)&file_inode, sizeof(Inode));
+    write_inode(target_inode, file_inode);
     set_inode_bitmap(target_inode, false);  // 更新inode位图
 
-    // 从根目录中移除该文件的目录项（标记为无效）
-    dir_entries[target_entry_idx].valid = 0;
-    write_block(root_inode.blocks[0], buffer);  // 写回根目录数据块
+    // 从所在目录中移除该文件的目录项（标记为无效）
+    dir_remove((uint32_t)parent, leaf);
 
-    // 更新根目录的修改时间
-    root_inode.modify_time = time(nullptr);
-    disk_file.seekp(get_inode_pos(0));
-    disk_file.write((char*)&root_inode, sizeof(Inode));
+    // 更新目录的修改时间（lazytime下仅暂存在内存中）
+    Inode dir_orig = dir_inode;
+    dir_inode.modify_time = time(nullptr);
+    update_inode((uint32_t)parent, dir_inode, dir_orig);
 
     return true;
 }
 
 /**
- * @brief 列出根目录中的所有文件（有效目录项）
- * @return 包含所有有效目录项的向量（不含"."目录）
+ * @brief 列出目录中的所有文件（有效目录项）
+ * @param path 目录路径（默认为根目录）
+ * @return 包含所有有效目录项的向量（不含"."目录）；目录不存在时为空
  */
-std::vector<DirEntry> DiskFS::list_files() {
+std::vector<DirEntry> DiskFS::list_files(const std::string& path) {
     std::vector<DirEntry> entries;  // 存储结果的向量
 
-    if (!isMounted()) return entries;  // 未挂载则返回空
-
-    // 读取根目录inode（0号）
-    Inode root_inode;
-    disk_file.seekg(get_inode_pos(0));
-    disk_file.read((char*)&root_inode, sizeof(Inode));
-    if (root_inode.type != 2) return entries;  // 根目录必须是目录类型
+    // 经目录遍历游标逐项收集（未挂载或目录不存在时返回空）
+    DirCursor cursor;
+    if (!open_dir(path, cursor)) return entries;
+    DirEntry entry;
+    while (read_dir(cursor, entry)) {
+        entries.push_back(entry);  // 添加到结果向量
+    }
 
-    // 读取根目录数据块
-    char buffer[BLOCK_SIZE];
-    if (!read_block(root_inode.blocks[0], buffer)) return entries;
-    DirEntry* dir_entries = (DirEntry*)buffer;  // 转换为目录项数组
+    return entries;
+}
 
-    // 遍历目录项，收集所有有效条目（跳过"."目录）
-    for (size_t i = 0; i < BLOCK_SIZE / sizeof(DirEntry); i++) {
-        if (dir_entries[i].valid) {
-            // 跳过"."目录（仅根目录有此条目）
-            if (i == 0 && std::string(dir_entries[i].name) == ".") {
-                continue;
-            }
-            entries.push_back(dir_entries[i]);  // 添加到结果向量
-        }
+/**
+ * @brief 按文件名顺序列出目录中位于[first, last)内的文件
+ * @param path 目录路径
+ * @param first 文件名下界（含）
+ * @param last 文件名上界（不含），空串表示无上界
+ * @return 范围内的目录项（按文件名排序）；目录不存在时为空
+ * 线性目录在有序文件名集合中定位下界后逐个取出，目录项由哈希索引直接给出，不读取目录块；
+ * B+树目录沿叶子链表读取。代价与结果数成正比，而非与目录大小成正比
+ */
+std::vector<DirEntry> DiskFS::list_range(const std::string& path, const std::string& first, const std::string& last) {
+    std::vector<DirEntry> entries;
+
+    if (!isMounted()) return entries;
+    SharedLock ns_lock(namespace_mutex);
+    int dir = resolve_path(path);
+    DirState* state = dir == -1 ? nullptr : get_dir((uint32_t)dir);
+    if (state == nullptr) return entries;  // 不存在或不是目录
+
+    if (state->tree_root != 0) {
+        dtree_range(state->tree_root, first, last, entries);
+        return entries;
     }
 
+    for (auto it = state->names.lower_bound(first); it != state->names.end(); ++it) {
+        if (!last.empty() && *it >= last) break;
+        const DirSlot& slot = *state->index.find(*it);
+        DirEntry entry;
+        memset(&entry, 0, sizeof(DirEntry));
+        strncpy(entry.name, it->c_str(), MAX_FILENAME - 1);
+        entry.inode_num = slot.inode_num;
+        entry.valid = 1;
+        entry.type = slot.type;
+        entries.push_back(entry);
+    }
     return entries;
 }
 
+/**
+ * @brief 按文件名顺序列出目录中以prefix开头的文件
+ * @param path 目录路径
+ * @param prefix 文件名前缀（空串表示全部文件）
+ * @return 匹配的目录项（按文件名排序）；目录不存在时为空
+ * 前缀查询即范围查询[prefix, prefix的后继)：后继为去掉末尾的0xFF后将最后一个字节加1
+ */
+std::vector<DirEntry> DiskFS::list_prefix(const std::string& path, const std::string& prefix) {
+    std::string last = prefix;
+    while (!last.empty() && (unsigned char)last.back() == 0xFF) last.pop_back();
+    if (!last.empty()) last.back() = (char)((unsigned char)last.back() + 1);
+    return list_range(path, prefix, last);
+}
+
 /**
  * @brief 打印磁盘的基本信息（总容量、空闲空间、inode使用情况等）
  */
@@ -398,6 +776,7 @@ void DiskFS::print_info()
         std::cout << "请先挂载磁盘（使用mount命令）\n";
         return;
     }
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);  // 空闲计数由分配器修改
 
     // 计算总容量和已使用容量（单位：MB）
     uint64_t total_size = (uint64_t)super_block.total_blocks * BLOCK_SIZE;
@@ -420,16 +799,13 @@ void DiskFS::print_info()
 }
 
 int DiskFS::get_file_size(int inode_num) {
-    if (!is_mounted || inode_num < 0 || (uint32_t)inode_num >= super_block.total_inodes) {
+    if (!is_mounted || inode_num < 0) {
         return -1;
     }
+    SharedLock lock(inode_lock(inode_num));
 
     Inode inode;
-    uint32_t pos = get_inode_pos(inode_num);
-    disk_file.seekg(pos);
-    disk_file.read((char*)&inode, sizeof(Inode));
-    
-    if (!disk_file.good() || !inode.used) {
+    if (!read_inode(inode_num, inode) || !inode.used) {
         return -1;
     }
 
@@ -452,32 +828,13 @@ bool DiskFS::is_inode_used(uint32_t inode_num) const
         return false;
     }
 
-    // 3. 清除文件流错误状态（避免之前的错误影响当前操作）
-    disk_file.clear();
-
-    // 4. 调用现有get_inode_pos获取inode在磁盘中的位置（字节偏移量）
-    uint32_t inode_offset = get_inode_pos(inode_num);
-    // std::cerr << "读取inode " << inode_num << "，偏移量：" << inode_offset << std::endl;  // 调试用
-
-    // 5. 定位到inode位置，并检查seek是否成功
-    disk_file.seekg(inode_offset);
-    if (disk_file.fail())
-    {
-        std::cerr << "inode " << inode_num << " 定位失败（偏移：" << inode_offset << "）" << std::endl;
-        return false;
-    }
-
-    // 6. 读取inode数据（使用sizeof(Inode)确保读取完整，避免INODE_SIZE不一致问题）
+    // 3. 通过read_inode读取inode数据（定长INODE_SIZE，内部会清除流错误状态）
     Inode inode;
-    disk_file.read((char*)&inode, sizeof(Inode));
-
-    // 7. 校验读取是否成功
-    if (disk_file.fail()) {
-        // std::cerr << "inode " << inode_num << " 读取失败（实际读取字节：" << disk_file.gcount() << "）" << std::endl;
+    if (!read_inode(inode_num, inode)) {
         return false;
     }
 
-    // 8. 调试输出（确认读取的used值）
+    // 4. 调试输出（确认读取的used值）
     // std::cout << "inode " << inode_num << " 的used状态：" << "["  << (int)inode.used << "]"<<std::endl;
 
     return inode.used;
@@ -0,0 +1,193 @@
+#include "../include/disk_fs.h"
+#include <iostream>
+#include <cstring>
+#include <vector>
+
+
+/**
+ * @brief 从磁盘读取一个inode
+ * @param inode_num 目标inode的编号
+ * @param inode 接收inode数据的结构体
+ * @return 读取成功返回true；inode编号无效或IO失败返回false
+ * inode为定长INODE_SIZE字节，按编号直接定位，不依赖平台的结构体填充
+ */
+bool DiskFS::read_inode(uint32_t inode_num, Inode& inode) const
+{
+    std::lock_guard<std::mutex> table_lock(inode_table_mutex);
+    if (inode_num >= super_block.total_inodes) return false;
+
+    // 挂载时已预加载inode表：直接从内存返回
+    if (inode_table_loaded) {
+        inode = inode_table[inode_num];
+    } else {
+        std::lock_guard<std::mutex> io_lock(io_mutex);
+        disk_file.clear();  // 清除之前的错误状态，避免影响本次读取
+        disk_file.seekg(get_inode_pos(inode_num));
+        disk_file.read((char*)&inode, INODE_SIZE);
+        if (!disk_file.good()) return false;
+    }
+
+    // lazytime：合并尚未写回的修改时间
+    auto it = pending_mtimes.find(inode_num);
+    if (it != pending_mtimes.end()) {
+        inode.modify_time = it->second;
+    }
+    return true;
+}
+
+/**
+ * @brief 向磁盘写入一个inode
+ * @param inode_num 目标inode的编号
+ * @param inode 待写入的inode数据
+ * @return 写入成功返回true；inode编号无效或IO失败返回false
+ */
+bool DiskFS::write_inode(uint32_t inode_num, const Inode& inode)
+{
+    std::lock_guard<std::mutex> table_lock(inode_table_mutex);
+    if (inode_num >= super_block.total_inodes) return false;
+
+    {
+        std::lock_guard<std::mutex> io_lock(io_mutex);
+        disk_file.clear();
+        disk_file.seekp(get_inode_pos(inode_num));
+        disk_file.write((const char*)&inode, INODE_SIZE);
+        if (!disk_file.good()) return false;
+    }
+
+    // 写穿：同步更新内存中的inode表副本
+    if (inode_table_loaded) {
+        inode_table[inode_num] = inode;
+    }
+    // 暂存的修改时间已随整个inode一起写回
+    pending_mtimes.erase(inode_num);
+    return true;
+}
+
+/**
+ * @brief 写回修改后的inode；开启lazytime且与orig相比仅修改时间不同时，只记录在内存中
+ * @param inode_num 目标inode的编号
+ * @param inode 修改后的inode
+ * @param orig 修改前的inode（由read_inode读出）
+ * @return 写入（或暂存）成功返回true；IO失败返回false
+ * 暂存的时间戳在该inode下次整体写回、sync()或卸载时落盘；进程异常退出会丢失这部分时间戳
+ */
+bool DiskFS::update_inode(uint32_t inode_num, const Inode& inode, const Inode& orig)
+{
+    if (mount_options.lazytime && inode_num < super_block.total_inodes) {
+        Inode cmp = inode;
+        cmp.modify_time = orig.modify_time;
+        if (memcmp(&cmp, &orig, INODE_SIZE) == 0) {
+            std::lock_guard<std::mutex> table_lock(inode_table_mutex);
+            pending_mtimes[inode_num] = inode.modify_time;
+            return true;
+        }
+    }
+    return write_inode(inode_num, inode);
+}
+
+/**
+ * @brief 将lazytime暂存的修改时间写回磁盘
+ * @return 全部写回成功返回true；任一inode读写失败返回false（失败项保留在内存中）
+ * 逐个持有inode锁读出并写回，避免覆盖其他线程对同一文件的并发写入
+ */
+bool DiskFS::flush_pending_times()
+{
+    bool ok = true;
+    std::vector<uint32_t> nums;
+    {
+        std::lock_guard<std::mutex> table_lock(inode_table_mutex);
+        for (const auto& item : pending_mtimes) nums.push_back(item.first);
+    }
+    for (uint32_t num : nums) {
+        std::lock_guard<SharedMutex> lock(inode_lock(num));
+        Inode inode;
+        // read_inode已合并暂存时间，write_inode写回后移除暂存项
+        if (!read_inode(num, inode) || !write_inode(num, inode)) ok = false;
+    }
+    return ok;
+}
+
+/**
+ * @brief 将整个inode表读入内存（挂载选项preload，在后台线程中执行）
+ * @return 读取成功返回true；打开镜像或IO失败返回false
+ * 使用独立的文件流，不与disk_file共享读写位置，因此可与挂载线程加载位图并行；
+ * 磁盘上连续的inode表块合并为一次顺序读（固定inode区与每个块组各一次），
+ * 避免逐个inode定位读取
+ */
+bool DiskFS::load_inode_table()
+{
+    std::ifstream in(disk_path, std::ios::in | std::ios::binary);
+    if (!in) return false;
+
+    const uint32_t inode_count = super_block.total_inodes;
+    const uint32_t table_blocks = (inode_count + INODES_PER_BLOCK - 1) / INODES_PER_BLOCK;
+    inode_table.assign(table_blocks * INODES_PER_BLOCK, Inode());
+
+    uint32_t b = 0;
+    while (b < table_blocks) {
+        // 找出从第b块开始、在磁盘上连续的一段inode表块
+        uint32_t first = get_inode_table_block(b);
+        uint32_t run = 1;
+        while (b + run < table_blocks && get_inode_table_block(b + run) == first + run) run++;
+
+        in.seekg((std::streamoff)first * BLOCK_SIZE);
+        in.read((char*)&inode_table[b * INODES_PER_BLOCK], (std::streamsize)run * BLOCK_SIZE);
+        if (!in.good()) return false;
+        b += run;
+    }
+    inode_table.resize(inode_count);
+    return true;
+}
+
+/**
+ * @brief 扩展inode表：从数据区划出一个块组（1个inode位图块 + 32个inode表块）
+ * @return 扩展成功返回true；块组数已达上限、数据区无足够连续空间或IO失败返回false
+ * 新块组的起始块号记录在超级块中，其inode编号紧接在现有inode之后，
+ * 因此按编号定位inode仍为O(1)；块组一经分配不再回收
+ */
+bool DiskFS::grow_inode_table()
+{
+    if (super_block.inode_chunk_count >= (uint32_t)MAX_INODE_CHUNKS) {
+        std::cerr << "扩展inode表失败：块组数已达上限" << std::endl;
+        return false;
+    }
+
+    // 1. 分配连续的INODE_CHUNK_BLOCKS个数据块
+    int start = find_free_run(INODE_CHUNK_BLOCKS);
+    if (start == -1) {
+        std::cerr << "扩展inode表失败：数据区没有足够的连续空间" << std::endl;
+        return false;
+    }
+    for (int i = 0; i < INODE_CHUNK_BLOCKS; i++) {
+        if (!set_block_bitmap(start + i, true)) return false;
+    }
+
+    // 2. 初始化块组：inode位图清零，inode表块按整块写入（全部为未使用状态）
+    char buffer[BLOCK_SIZE];
+    memset(buffer, 0, BLOCK_SIZE);
+    bitmap_cache[start].assign(BLOCK_SIZE, 0);
+    if (!flush_bitmap_block(start)) return false;
+
+    uint32_t first_inode = super_block.total_inodes;
+    Inode* table = (Inode*)buffer;
+    for (int b = 0; b < INODE_CHUNK_TABLE_BLOCKS; b++) {
+        memset(buffer, 0, BLOCK_SIZE);
+        for (int j = 0; j < INODES_PER_BLOCK; j++) {
+            table[j].inode_num = first_inode + b * INODES_PER_BLOCK + j;
+        }
+        if (!write_block(start + 1 + b, buffer)) return false;
+    }
+
+    // 3. 在超级块中登记新块组（与inode表副本一同在inode表锁内更新，read_inode据此判断编号范围）
+    {
+        std::lock_guard<std::mutex> table_lock(inode_table_mutex);
+        if (inode_table_loaded) {
+            inode_table.resize(first_inode + INODE_CHUNK_INODES);
+            for (uint32_t i = first_inode; i < first_inode + INODE_CHUNK_INODES; i++) inode_table[i].inode_num = i;
+        }
+        super_block.inode_chunks[super_block.inode_chunk_count++] = (uint32_t)start;
+        super_block.total_inodes += INODE_CHUNK_INODES;
+    }
+    super_block.free_inodes += INODE_CHUNK_INODES;
+    return write_super_block();
+}
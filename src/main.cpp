@@ -28,6 +28,7 @@ Task parse_command(const std::string& input) {
     std::string cmd = tokens[0];
     if (cmd == "ls") {
         task.type = CommandType::LS;
+        if (tokens.size() > 1) task.args.push_back(tokens[1]);
     } else if (cmd == "cat") {
         task.type = CommandType::CAT;
         if (tokens.size() > 1) task.args.push_back(tokens[1]);
@@ -52,6 +53,12 @@ Task parse_command(const std::string& input) {
     } else if (cmd == "touch" || cmd == "create") {
         task.type = CommandType::TOUCH;
         if (tokens.size() > 1) task.args.push_back(tokens[1]);
+    } else if (cmd == "mkdir") {
+        task.type = CommandType::MKDIR;
+        if (tokens.size() > 1) task.args.push_back(tokens[1]);
+    } else if (cmd == "rmdir") {
+        task.type = CommandType::RMDIR;
+        if (tokens.size() > 1) task.args.push_back(tokens[1]);
     } else if (cmd == "exit") {
         task.type = CommandType::EXIT;
     } else {
@@ -79,7 +86,7 @@ int main() {
 
     // 创建线程池（使用4个工作线程）
     ThreadPool pool(&disk, 4);
-    std::cout << "多线程磁盘模拟器启动成功，支持命令：ls/cat/rm/copy/write/touch/exit" << std::endl;
+    std::cout << "多线程磁盘模拟器启动成功，支持命令：ls/cat/rm/copy/write/touch/mkdir/rmdir/exit" << std::endl;
     std::cout << "> " << std::flush;
 
     // 命令输入循环
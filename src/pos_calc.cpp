@@ -3,17 +3,32 @@
 
 /**
  * @brief 计算inode在磁盘中的字节偏移量
- * @param inode_num 目标inode的编号（0~MAX_INODES-1）
+ * @param inode_num 目标inode的编号（0~总inode数-1）
  * @return 若inode编号有效，返回其在磁盘中的起始字节位置；否则返回0（无效位置）
- * 计算逻辑：inode区起始块 × 块大小 + inode编号 × 单个inode大小
+ * 计算逻辑：inode所在的inode表块 × 块大小 + 块内下标 × 单个inode大小（INODE_SIZE，与平台无关）
+ * 固定inode区与动态块组中的inode均可直接算出位置，查找为O(1)
  */
 uint32_t DiskFS::get_inode_pos(uint32_t inode_num) const {
     // 检查inode编号是否超出允许范围（总inode数由超级块定义）
     if (inode_num >= super_block.total_inodes) return 0;
-    // inode区起始位置 = 超级块中记录的inode起始块 × 块大小
-    // 目标inode位置 = inode区起始位置 + inode编号 × 单个inode大小（INODE_SIZE）
-    //return super_block.inode_start * BLOCK_SIZE + inode_num * INODE_SIZE;
-    return super_block.inode_start * BLOCK_SIZE + inode_num * sizeof(struct Inode);
+    uint32_t table_block = get_inode_table_block(inode_num / INODES_PER_BLOCK);
+    return table_block * BLOCK_SIZE + (inode_num % INODES_PER_BLOCK) * INODE_SIZE;
+}
+
+/**
+ * @brief 计算第index个inode表块的磁盘块号（第index块存放inode [index×32, index×32+32)）
+ * @param index inode表块的序号
+ * @return 对应的磁盘块号
+ * 前MAX_INODES个inode位于固定inode区，其后的inode按编号依次位于各动态块组中
+ */
+uint32_t DiskFS::get_inode_table_block(uint32_t index) const {
+    const uint32_t fixed_blocks = MAX_INODES / INODES_PER_BLOCK;
+    if (index < fixed_blocks) {
+        return super_block.inode_start + index;
+    }
+    index -= fixed_blocks;
+    // 块组首块为inode位图，inode表块从第1块开始
+    return super_block.inode_chunks[index / INODE_CHUNK_TABLE_BLOCKS] + 1 + index % INODE_CHUNK_TABLE_BLOCKS;
 }
 
 /**
@@ -0,0 +1,179 @@
+#include "../include/disk_fs.h"
+#include <cstring>
+#include <algorithm>
+
+/**
+ * @brief 计算一段尾部数据在共享块中占用的片段位图
+ * @param offset 尾部数据在块内的字节偏移
+ * @param len 尾部数据长度
+ */
+static uint16_t tail_mask(uint32_t offset, uint32_t len)
+{
+    uint32_t first = offset / TAIL_FRAGMENT_SIZE;
+    uint32_t count = (len + TAIL_FRAGMENT_SIZE - 1) / TAIL_FRAGMENT_SIZE;
+    return (uint16_t)(((1u << count) - 1) << first);
+}
+
+// 已用片段位图中最长一段连续空闲片段的长度
+static uint32_t longest_free(uint16_t used)
+{
+    uint32_t longest = 0, run = 0;
+    for (int i = 0; i < TAIL_SLOTS_PER_BLOCK; i++) {
+        run = (used & (1u << i)) ? 0 : run + 1;
+        longest = std::max(longest, run);
+    }
+    return longest;
+}
+
+/**
+ * @brief 查找count个连续空闲片段
+ * @param count 片段数（1~TAIL_SLOTS_PER_BLOCK）
+ * @param block 输出参数：共享块的块号
+ * @param first 输出参数：第一个片段的序号
+ * @return 找到返回true；已有的共享块都放不下返回false
+ * 优先使用最长空闲段恰好够用的块，较长的空闲段留给较大的尾部
+ */
+bool TailSlots::find(uint32_t count, uint32_t& block, uint32_t& first) const
+{
+    uint16_t run = (uint16_t)((1u << count) - 1);
+    for (uint32_t k = count; k < (uint32_t)TAIL_SLOTS_PER_BLOCK; k++) {
+        if (by_run[k - 1].empty()) continue;
+        block = *by_run[k - 1].begin();
+        uint16_t bits = used(block);
+        for (first = 0; first + count <= (uint32_t)TAIL_SLOTS_PER_BLOCK; first++) {
+            if (!(bits & (run << first))) return true;
+        }
+    }
+    return false;
+}
+
+uint16_t TailSlots::used(uint32_t block) const
+{
+    auto it = used_map.find(block);
+    return it == used_map.end() ? 0 : it->second;
+}
+
+void TailSlots::set(uint32_t block, uint16_t bits)
+{
+    auto it = used_map.find(block);
+    if (it != used_map.end()) {
+        uint32_t old_run = longest_free(it->second);
+        if (old_run > 0) by_run[old_run - 1].erase(block);
+    }
+    if (bits == 0) {
+        if (it != used_map.end()) used_map.erase(it);
+        return;
+    }
+    used_map[block] = bits;
+    uint32_t new_run = longest_free(bits);
+    if (new_run > 0) by_run[new_run - 1].insert(block);
+}
+
+void TailSlots::clear()
+{
+    std::unordered_map<uint32_t, uint16_t>().swap(used_map);
+    for (auto& blocks : by_run) std::unordered_set<uint32_t>().swap(blocks);
+}
+
+/**
+ * @brief 扫描inode表，重建共享尾部块的片段占用情况（挂载时调用）
+ * @return 扫描成功返回true；读取inode表失败返回false
+ * 片段位图只保存在内存中：共享块本身在块位图中标记为已使用，
+ * 各片段归属由inode的tail_block/tail_offset记录，按inode表块整块读取
+ */
+bool DiskFS::load_tail_slots()
+{
+    tail_slots.clear();
+
+    char buffer[BLOCK_SIZE];
+    uint32_t inode_count = super_block.total_inodes;
+    for (uint32_t b = 0; b * INODES_PER_BLOCK < inode_count; b++) {
+        // 已预加载inode表时直接扫描内存副本
+        const Inode* table = (const Inode*)buffer;
+        if (inode_table_loaded) {
+            table = &inode_table[b * INODES_PER_BLOCK];
+        } else if (!read_block(get_inode_table_block(b), buffer)) {
+            return false;
+        }
+        for (int j = 0; j < INODES_PER_BLOCK && b * INODES_PER_BLOCK + j < inode_count; j++) {
+            const Inode& inode = table[j];
+            if (!inode.used || !(inode.flags & INODE_FLAG_TAIL)) continue;
+            uint32_t len = inode.size % BLOCK_SIZE;
+            tail_slots.set(inode.tail_block, tail_slots.used(inode.tail_block) | tail_mask(inode.tail_offset, len));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 读取文件存放在共享块中的尾部数据
+ * @param inode 文件的inode（必须带INODE_FLAG_TAIL）
+ * @param buffer 接收数据的缓冲区（至少size % BLOCK_SIZE字节）
+ * @return 读取成功返回true；IO失败返回false
+ */
+bool DiskFS::read_tail(const Inode& inode, char* buffer)
+{
+    uint32_t len = inode.size % BLOCK_SIZE;
+    return read_bytes(inode.tail_block * BLOCK_SIZE + inode.tail_offset, buffer, len);
+}
+
+/**
+ * @brief 将文件尾部数据存入共享块，并在inode中记录位置
+ * @param inode 文件的inode（调用者负责写回；原有尾部片段的位置会被覆盖，由调用者另行保存并释放）
+ * @param data 尾部数据
+ * @param len 尾部数据长度（1~TAIL_PACK_MAX字节）
+ * @return 存放成功返回true；无可用空间或IO失败返回false
+ * 优先放入已有共享块中的连续空闲片段（按最长空闲段分组查找），没有时分配一个新的共享块；
+ * 只写入尾部数据所在的字节范围，不读写整个块
+ */
+bool DiskFS::store_tail(Inode& inode, const char* data, uint32_t len)
+{
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    uint32_t count = (len + TAIL_FRAGMENT_SIZE - 1) / TAIL_FRAGMENT_SIZE;
+    uint16_t run = (uint16_t)((1u << count) - 1);
+
+    // 1. 在已有共享块中查找count个连续空闲片段
+    uint32_t block_num = 0;
+    uint32_t first = 0;
+    bool shared = tail_slots.find(count, block_num, first);
+
+    // 2. 没有合适的位置：分配新的共享块
+    if (!shared) {
+        int new_block = alloc_block();
+        if (new_block == -1) return false;
+        block_num = (uint32_t)new_block;
+        first = 0;
+    }
+
+    // 3. 写入尾部数据并记录位置
+    uint32_t offset = first * TAIL_FRAGMENT_SIZE;
+    if (!write_bytes(block_num * BLOCK_SIZE + offset, data, len)) {
+        if (!shared) set_block_bitmap(block_num, false);
+        return false;
+    }
+    tail_slots.set(block_num, (uint16_t)(tail_slots.used(block_num) | (run << first)));
+    inode.tail_block = block_num;
+    inode.tail_offset = (uint16_t)offset;
+    inode.flags |= INODE_FLAG_TAIL;
+    return true;
+}
+
+/**
+ * @brief 释放文件占用的尾部片段；共享块中的片段全部空闲时释放该块
+ * @param inode 文件的inode（调用者负责写回）
+ */
+void DiskFS::release_tail(Inode& inode)
+{
+    std::lock_guard<std::recursive_mutex> alloc_lock(alloc_mutex);
+    if (!(inode.flags & INODE_FLAG_TAIL)) return;
+
+    uint16_t used = tail_slots.used(inode.tail_block);
+    if (used != 0) {
+        used &= ~tail_mask(inode.tail_offset, inode.size % BLOCK_SIZE);
+        tail_slots.set(inode.tail_block, used);
+        if (used == 0) set_block_bitmap(inode.tail_block, false);
+    }
+    inode.flags &= ~INODE_FLAG_TAIL;
+    inode.tail_block = 0;
+    inode.tail_offset = 0;
+}
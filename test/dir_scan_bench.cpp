@@ -0,0 +1,127 @@
+#include "../include/disk_fs.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+// 基准测试配置参数
+const size_t LOOKUPS = 200000;            // 每组测试的查找次数（命中与不命中各半）
+const size_t TAG_SCAN_ROUNDS = 2000;      // 标签扫描内核的重复轮数
+const size_t DIR_SIZES[] = {16, 128, 1024, 2048};  // 目录项数（线性目录最多约2000项）
+
+// 防止编译器优化掉测试结果
+static volatile uint64_t sink;
+
+// 计时辅助：先运行一遍预热，再计时并返回每次操作的纳秒数
+template <typename F>
+double time_ns(size_t ops, F f)
+{
+    f();
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+// 生成文件名（带公共前缀，与真实目录中的命名相似）
+std::vector<std::string> make_names(size_t count, const std::string& prefix, std::mt19937& gen)
+{
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; i++) {
+        names.push_back(prefix + std::to_string(gen()) + "_" + std::to_string(i));
+    }
+    return names;
+}
+
+int main()
+{
+    std::mt19937 gen(42);
+    std::cout << "目录查找基准测试（每次查找的平均耗时，纳秒）" << std::endl;
+    std::cout << std::setw(8) << "目录项数" << std::setw(16) << "逐项比较文件名"
+              << std::setw(16) << "unordered_map" << std::setw(12) << "DirIndex" << std::endl;
+
+    for (size_t n : DIR_SIZES) {
+        std::vector<std::string> names = make_names(n, "file_", gen);
+        std::vector<std::string> misses = make_names(n, "file_", gen);
+        std::vector<std::string> probes;
+        for (size_t i = 0; i < LOOKUPS; i++) {
+            probes.push_back(i % 2 ? names[gen() % n] : misses[gen() % n]);
+        }
+
+        // 1. 原有实现：逐项比较文件名，跳过无效目录项
+        std::vector<DirEntry> entries(n);
+        for (size_t i = 0; i < n; i++) {
+            entries[i].inode_num = (int)i + 1;
+            entries[i].valid = (i % 7) != 0;  // 约1/7的目录项为已删除项
+            names[i].copy(entries[i].name, MAX_FILENAME - 1);
+            entries[i].name[names[i].size()] = '\0';
+        }
+        size_t scalar_ops = n > 1024 ? LOOKUPS / 10 : LOOKUPS;  // 大目录下逐项比较过慢，减少次数
+        double scalar = time_ns(scalar_ops, [&] {
+            uint64_t found = 0;
+            for (size_t i = 0; i < scalar_ops; i++) {
+                for (size_t j = 0; j < n; j++) {
+                    if (entries[j].valid && probes[i] == entries[j].name) {
+                        found += entries[j].inode_num;
+                        break;
+                    }
+                }
+            }
+            sink = found;
+        });
+
+        // 2. 标准库哈希表
+        std::unordered_map<std::string, DirSlot> map;
+        // 3. 按组比较标签的目录哈希索引
+        DirIndex index;
+        for (size_t i = 0; i < n; i++) {
+            DirSlot slot = {(uint32_t)i + 1, 0, 0, 1};
+            map[names[i]] = slot;
+            index.insert(names[i], slot);
+        }
+        double hashed = time_ns(LOOKUPS, [&] {
+            uint64_t found = 0;
+            for (const auto& name : probes) {
+                auto it = map.find(name);
+                if (it != map.end()) found += it->second.inode_num;
+            }
+            sink = found;
+        });
+        double grouped = time_ns(LOOKUPS, [&] {
+            uint64_t found = 0;
+            for (const auto& name : probes) {
+                const DirSlot* slot = index.find(name);
+                if (slot != nullptr) found += slot->inode_num;
+            }
+            sink = found;
+        });
+
+        std::cout << std::fixed << std::setprecision(1) << std::setw(8) << n << std::setw(16) << scalar
+                  << std::setw(16) << hashed << std::setw(12) << grouped << std::endl;
+    }
+
+    // 4. 标签匹配内核本身：SIMD与逐个比较
+    std::vector<uint8_t> tags(64 * 1024);
+    for (auto& tag : tags) tag = (uint8_t)(gen() & 0xFF);
+    size_t groups = tags.size() / DIR_INDEX_GROUP;
+    double simd = time_ns(TAG_SCAN_ROUNDS * groups, [&] {
+        uint64_t hits = 0;
+        for (size_t r = 0; r < TAG_SCAN_ROUNDS; r++) {
+            for (size_t g = 0; g < groups; g++) hits += dir_tag_match(&tags[g * DIR_INDEX_GROUP], (uint8_t)r & 0x7F);
+        }
+        sink = hits;
+    });
+    double scalar = time_ns(TAG_SCAN_ROUNDS * groups, [&] {
+        uint64_t hits = 0;
+        for (size_t r = 0; r < TAG_SCAN_ROUNDS; r++) {
+            for (size_t g = 0; g < groups; g++) hits += dir_tag_match_scalar(&tags[g * DIR_INDEX_GROUP], (uint8_t)r & 0x7F);
+        }
+        sink = hits;
+    });
+    std::cout << "标签匹配内核（每组" << DIR_INDEX_GROUP << "个标签，纳秒/组）：dir_tag_match "
+              << std::setprecision(2) << simd << "，逐个比较 " << scalar << std::endl;
+    return 0;
+}
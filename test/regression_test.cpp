@@ -0,0 +1,932 @@
+#include "../include/disk_fs.h"
+#include "../include/task_queue.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <future>
+#include <functional>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// 回归测试：按功能分组的快速检查（磁盘格式、文件存储形态、目录结构、目录遍历、并发访问与线程池），
+// 每组检查结束后重新挂载验证持久化。各组使用同一个镜像文件（每组开始时重新格式化），结束后删除；
+// 任何检查失败时以非0状态退出（make test会执行本程序）
+
+const std::string IMAGE = "regression_test.img";  // 测试镜像文件
+
+static std::ostream report(std::cout.rdbuf());  // 测试结果输出（文件系统自身的提示信息被屏蔽）
+static int failures = 0;                         // 失败的检查数
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            failures++; \
+            report << "  检查失败 " << __FILE__ << ":" << __LINE__ << "：" << #cond << std::endl; \
+        } \
+    } while (0)
+
+// 按路径读取整个文件；文件不存在时返回"<none>"
+static std::string read_all(DiskFS& disk, const std::string& path)
+{
+    std::string content;
+    return disk.read_path(path, content) < 0 ? "<none>" : content;
+}
+
+// 生成长度为len、内容随位置与种子变化的数据（便于发现错位）
+static std::string pattern(size_t len, int seed)
+{
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; i++) data[i] = (char)('a' + (i * 7 + seed * 13 + i / BLOCK_SIZE) % 26);
+    return data;
+}
+
+// 在model上模拟offset处写入data（写入不截断文件）
+static void model_write(std::string& model, const std::string& data, size_t offset)
+{
+    if (model.size() < offset + data.size()) model.resize(offset + data.size(), '\0');
+    model.replace(offset, data.size(), data);
+}
+
+// 按offset写入data并同步更新model
+static bool write_model(DiskFS& disk, const std::string& path, std::string& model, const std::string& data, size_t offset)
+{
+    model_write(model, data, offset);
+    return disk.write_path(path, data.data(), data.size(), offset, OPEN_CREATE) == (int)data.size();
+}
+
+/**
+ * SIMFSv1镜像：inode按平台的sizeof(InodeV1)紧密排列，目录为36字节的定长目录项，只有16个直接块指针
+ */
+struct InodeV1
+{
+    uint32_t inode_num;
+    uint32_t size;
+    uint32_t blocks[16];
+    uint8_t type;
+    uint8_t used;
+    time_t create_time;
+    time_t modify_time;
+};
+
+struct DirEntryV1
+{
+    char name[28];
+    uint32_t inode_num;
+    uint8_t valid;
+    uint8_t type;
+};
+
+/**
+ * @brief 写入一个SIMFSv1镜像：根目录含hello.txt（2块，位于升级时需搬迁的区域）、big.bin（10块）与子目录sub，
+ *        sub中含inner.txt
+ */
+static bool write_v1_image(const std::string& hello, const std::string& big, const std::string& inner)
+{
+    std::ofstream image(IMAGE, std::ios::binary | std::ios::trunc);
+    uint32_t inode_blocks = (MAX_INODES * sizeof(InodeV1) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    SuperBlock sb;
+    memset(&sb, 0, sizeof(sb));
+    strcpy(sb.magic, FS_MAGIC_V1);
+    sb.block_size = BLOCK_SIZE;
+    sb.total_blocks = MAX_BLOCKS;
+    sb.block_bitmap = 1;
+    sb.inode_bitmap = 2;
+    sb.inode_start = 3;
+    sb.inode_blocks = inode_blocks;
+    sb.data_start = sb.inode_start + inode_blocks;
+    sb.data_blocks = MAX_BLOCKS - sb.data_start;
+    sb.total_inodes = MAX_INODES;
+
+    auto write_block = [&image](uint32_t block_num, const char* data) {
+        image.seekp((uint64_t)block_num * BLOCK_SIZE);
+        image.write(data, BLOCK_SIZE);
+    };
+    const uint32_t d = sb.data_start;
+    const uint32_t root_block = d, hello_block = d + 1, sub_block = d + 40, inner_block = d + 41, big_block = d + 50;
+
+    // 数据块
+    std::vector<char> block(BLOCK_SIZE, 0);
+    DirEntryV1* entries = (DirEntryV1*)block.data();
+    const char* root_names[] = {".", "hello.txt", "big.bin", "sub"};
+    const uint32_t root_inodes[] = {0, 1, 2, 3};
+    const uint8_t root_types[] = {2, 1, 1, 2};
+    for (int i = 0; i < 4; i++) {
+        strcpy(entries[i].name, root_names[i]);
+        entries[i].inode_num = root_inodes[i];
+        entries[i].valid = 1;
+        entries[i].type = root_types[i];
+    }
+    write_block(root_block, block.data());
+    std::fill(block.begin(), block.end(), 0);
+    strcpy(entries[0].name, ".");
+    entries[0].inode_num = 3;
+    entries[0].valid = 1;
+    entries[0].type = 2;
+    strcpy(entries[2].name, "inner.txt");  // 中间留一个无效目录项
+    entries[2].inode_num = 4;
+    entries[2].valid = 1;
+    entries[2].type = 1;
+    write_block(sub_block, block.data());
+    auto write_data = [&](uint32_t first, const std::string& data) {
+        for (size_t off = 0; off < data.size(); off += BLOCK_SIZE) {
+            std::fill(block.begin(), block.end(), 0);
+            memcpy(block.data(), data.data() + off, std::min((size_t)BLOCK_SIZE, data.size() - off));
+            write_block(first + off / BLOCK_SIZE, block.data());
+        }
+    };
+    write_data(hello_block, hello);
+    write_data(big_block, big);
+    write_data(inner_block, inner);
+
+    // inode表
+    std::vector<InodeV1> inodes(MAX_INODES);
+    memset(inodes.data(), 0, inodes.size() * sizeof(InodeV1));
+    for (uint32_t i = 0; i < (uint32_t)MAX_INODES; i++) inodes[i].inode_num = i;
+    auto set_inode = [&](uint32_t num, uint8_t type, const std::string& data, uint32_t first, uint32_t size) {
+        inodes[num].type = type;
+        inodes[num].used = 1;
+        inodes[num].size = size != 0 ? size : data.size();
+        inodes[num].create_time = inodes[num].modify_time = 1000000 + num;
+        for (uint32_t b = 0; b * BLOCK_SIZE < inodes[num].size; b++) inodes[num].blocks[b] = first + b;
+    };
+    set_inode(0, 2, "", root_block, BLOCK_SIZE);
+    set_inode(1, 1, hello, hello_block, 0);
+    set_inode(2, 1, big, big_block, 0);
+    set_inode(3, 2, "", sub_block, BLOCK_SIZE);
+    set_inode(4, 1, inner, inner_block, 0);
+    image.seekp((uint64_t)sb.inode_start * BLOCK_SIZE);
+    image.write((const char*)inodes.data(), inodes.size() * sizeof(InodeV1));
+
+    // 位图（块位图按数据区内的序号计位）
+    std::vector<char> bitmap(BLOCK_SIZE, 0);
+    uint32_t used_blocks = 0;
+    for (uint32_t i = 0; i < 5; i++) {
+        for (uint32_t b = 0; b < 16 && inodes[i].blocks[b] != 0; b++) {
+            uint32_t idx = inodes[i].blocks[b] - d;
+            bitmap[idx / 8] |= (char)(1 << (idx % 8));
+            used_blocks++;
+        }
+    }
+    write_block(sb.block_bitmap, bitmap.data());
+    std::fill(bitmap.begin(), bitmap.end(), 0);
+    bitmap[0] = 0x1F;
+    write_block(sb.inode_bitmap, bitmap.data());
+
+    sb.free_blocks = sb.data_blocks - used_blocks;
+    sb.free_inodes = MAX_INODES - 5;
+    image.seekp(0);
+    image.write((const char*)&sb, sizeof(sb));
+    return image.good();
+}
+
+// v1镜像挂载时升级为v2，升级后的内容可读，新写入的内容在重新挂载后仍在
+static void test_v1_upgrade()
+{
+    const std::string hello = pattern(BLOCK_SIZE + 1000, 1), big = pattern(10 * BLOCK_SIZE - 7, 2), inner = "inner file";
+    CHECK(write_v1_image(hello, big, inner));
+
+    DiskFS disk(IMAGE);
+    CHECK(disk.mount());
+    CHECK(strcmp(disk.get_super_block().magic, FS_MAGIC) == 0);
+    std::set<std::string> names;
+    for (const auto& entry : disk.list_files("/")) names.insert(entry.name);
+    CHECK(names == std::set<std::string>({"hello.txt", "big.bin", "sub"}));
+    CHECK(read_all(disk, "hello.txt") == hello);
+    CHECK(read_all(disk, "big.bin") == big);
+    CHECK(read_all(disk, "sub/inner.txt") == inner);
+
+    // 升级后的目录可以继续增删，旧文件可以继续写入
+    const std::string added = pattern(3000, 3);
+    CHECK(disk.write_path("sub/new.txt", added.data(), added.size(), 0, OPEN_CREATE) == (int)added.size());
+    std::string expect = hello;
+    CHECK(write_model(disk, "hello.txt", expect, "HELLO", 0));
+    CHECK(disk.delete_file("big.bin"));
+    CHECK(disk.unmount());
+
+    CHECK(disk.mount());
+    CHECK(read_all(disk, "hello.txt") == expect);
+    CHECK(read_all(disk, "big.bin") == "<none>");
+    CHECK(read_all(disk, "sub/inner.txt") == inner);
+    CHECK(read_all(disk, "sub/new.txt") == added);
+    CHECK(disk.unmount());
+}
+
+/**
+ * 大文件的块映射：超出直接块后经一级、二级间接块（或extent树）映射；跨越映射边界的覆盖写入、
+ * 隔块写入形成的空洞（extent树中为大量不连续的extent）、重新挂载，以及删除后回收全部数据块与映射块
+ */
+static void test_block_maps(bool extents)
+{
+    DiskFS disk(IMAGE);
+    MountOptions options;
+    options.extents = extents;
+    CHECK(disk.format());
+    CHECK(disk.mount(options));
+    const uint32_t free_blocks = disk.get_super_block().free_blocks;
+
+    // 逐步增长到需要二级间接块的大小
+    std::string model;
+    const size_t sizes[] = {3 * BLOCK_SIZE, DIRECT_BLOCKS * BLOCK_SIZE + 5, (DIRECT_BLOCKS + 100) * BLOCK_SIZE,
+                            (DIRECT_BLOCKS + PTRS_PER_BLOCK + 3) * BLOCK_SIZE + 100};
+    int seed = 0;
+    for (size_t size : sizes) {
+        CHECK(write_model(disk, "large", model, pattern(size - model.size(), ++seed), model.size()));
+        CHECK(read_all(disk, "large") == model);
+    }
+    // 跨越直接块/一级间接块/二级间接块边界的覆盖写入
+    const size_t offsets[] = {0, DIRECT_BLOCKS * BLOCK_SIZE - 10, (DIRECT_BLOCKS + PTRS_PER_BLOCK) * BLOCK_SIZE - 10, model.size() - 5};
+    for (size_t offset : offsets) {
+        CHECK(write_model(disk, "large", model, pattern(BLOCK_SIZE + 20, ++seed), offset));
+    }
+    CHECK(read_all(disk, "large") == model);
+
+    // 隔块写入：未写入的块为空洞，按全0读出
+    std::string sparse;
+    for (size_t b = 0; b < 300; b += 2) {
+        CHECK(write_model(disk, "sparse", sparse, pattern(100, ++seed), b * BLOCK_SIZE + 7));
+    }
+    CHECK(read_all(disk, "sparse") == sparse);
+
+    CHECK(disk.unmount());
+    CHECK(disk.mount(options));
+    CHECK(read_all(disk, "large") == model);
+    CHECK(read_all(disk, "sparse") == sparse);
+
+    // 删除后全部数据块与映射块（间接块、extent树块）回收
+    CHECK(disk.delete_file("large"));
+    CHECK(disk.delete_file("sparse"));
+    CHECK(disk.get_super_block().free_blocks == free_blocks);
+    CHECK(disk.unmount());
+}
+
+/**
+ * 小文件内联存放在inode中：不超过INLINE_DATA_SIZE时不占用数据块，内联区内的覆盖写入，
+ * 超出后迁移到数据块；删除后以较小的内容重写又回到内联形态
+ */
+static void test_inline_data()
+{
+    DiskFS disk(IMAGE);
+    CHECK(disk.format());
+    CHECK(disk.mount());
+    const uint32_t free_blocks = disk.get_super_block().free_blocks;
+    const uint32_t free_inodes = disk.get_super_block().free_inodes;
+
+    std::string tiny, full;
+    CHECK(write_model(disk, "tiny", tiny, "0123456789", 0));
+    CHECK(write_model(disk, "tiny", tiny, "abc", 4));
+    CHECK(write_model(disk, "tiny", tiny, pattern(20, 1), 60));  // 中间留空洞（按全0读出）
+    CHECK(disk.create_file("full") >= 0);
+    CHECK(write_model(disk, "full", full, pattern(INLINE_DATA_SIZE, 2), 0));
+    CHECK(disk.get_super_block().free_blocks == free_blocks);
+    CHECK(read_all(disk, "tiny") == tiny);
+    CHECK(read_all(disk, "full") == full);
+
+    // 超出inode容量：已有内容迁移到数据块
+    CHECK(write_model(disk, "full", full, "X", INLINE_DATA_SIZE));
+    CHECK(disk.get_super_block().free_blocks < free_blocks);
+    CHECK(read_all(disk, "full") == full);
+    CHECK(write_model(disk, "full", full, pattern(5000, 3), 50));
+    CHECK(read_all(disk, "full") == full);
+
+    CHECK(disk.unmount());
+    CHECK(disk.mount());
+    CHECK(read_all(disk, "tiny") == tiny);
+    CHECK(read_all(disk, "full") == full);
+
+    // 删除后重写为小文件：回到内联形态，数据块全部回收
+    CHECK(disk.delete_file("full"));
+    full.clear();
+    CHECK(write_model(disk, "full", full, "small again", 0));
+    CHECK(read_all(disk, "full") == full);
+    CHECK(disk.get_super_block().free_blocks == free_blocks);
+
+    CHECK(disk.delete_file("tiny"));
+    CHECK(disk.delete_file("full"));
+    CHECK(disk.get_super_block().free_inodes == free_inodes);
+    CHECK(disk.unmount());
+}
+
+// 直接从镜像文件读取inode（卸载后或sync之后检查磁盘上的内容）
+static bool read_raw_inode(uint32_t inode_num, Inode& inode)
+{
+    std::ifstream image(IMAGE, std::ios::binary);
+    SuperBlock sb;
+    if (!image.read((char*)&sb, sizeof(sb)) || inode_num >= (uint32_t)MAX_INODES) return false;
+    image.seekg((uint64_t)(sb.inode_start + inode_num / INODES_PER_BLOCK) * BLOCK_SIZE + (inode_num % INODES_PER_BLOCK) * INODE_SIZE);
+    return (bool)image.read((char*)&inode, sizeof(inode));
+}
+
+// 等到当前时间（秒）超过t，使随后的修改时间可以区分
+static void wait_past(time_t t)
+{
+    while (time(nullptr) <= t) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+/**
+ * 文件尾部打包进共享块：多个小文件共用一个块，删除后空出的片段被新的尾部复用；
+ * 文件增长、覆盖写入跨越数据块与尾部的边界；不改变文件大小的覆盖写入原地进行，尾部位置不变，
+ * lazytime下只有修改时间变化的inode更新被暂存
+ */
+static void test_tail_packing(bool extents)
+{
+    DiskFS disk(IMAGE);
+    MountOptions options;
+    options.extents = extents;
+    options.lazytime = true;
+    CHECK(disk.format());
+    CHECK(disk.mount(options));
+    const uint32_t free_blocks = disk.get_super_block().free_blocks;
+    std::map<std::string, std::string> files;
+
+    // 不改变文件大小的覆盖写入（只写数据块、只写尾部、同时写两者）：尾部原地写入，即使共享块中
+    // 尾部之前已空出足够的片段也不移动；inode只有修改时间变化，lazytime下暂存在内存中
+    // （读取文件时镜像文件已写入，磁盘上仍是旧inode），sync后写回
+    std::string& first = files["first"];
+    std::string& tail = files["tail"];
+    CHECK(write_model(disk, "first", first, pattern(1000, 10), 0));
+    CHECK(write_model(disk, "tail", tail, pattern(BLOCK_SIZE + 900, 11), 0));
+    CHECK(disk.delete_file("first"));
+    files.erase("first");
+    int inode_num = disk.open_file("tail");
+    CHECK(disk.sync());
+    Inode before;
+    CHECK(read_raw_inode((uint32_t)inode_num, before));
+    CHECK((before.flags & INODE_FLAG_TAIL) != 0 && before.tail_offset > 0);
+    wait_past(before.modify_time);
+    CHECK(write_model(disk, "tail", tail, "head", 0));
+    CHECK(write_model(disk, "tail", tail, "end", tail.size() - 3));
+    CHECK(write_model(disk, "tail", tail, pattern(1000, 12), BLOCK_SIZE - 500));
+    CHECK(read_all(disk, "tail") == tail);
+    Inode deferred;
+    CHECK(read_raw_inode((uint32_t)inode_num, deferred));
+    CHECK(deferred.modify_time == before.modify_time);
+    CHECK(disk.sync());
+    Inode synced;
+    CHECK(read_raw_inode((uint32_t)inode_num, synced));
+    CHECK(synced.modify_time > before.modify_time);
+    CHECK(synced.tail_block == before.tail_block && synced.tail_offset == before.tail_offset);
+    CHECK(synced.size == before.size);
+
+    // 16个一个片段大小的文件共用一个共享块
+    uint32_t used = disk.get_super_block().free_blocks;
+    for (int i = 0; i < TAIL_SLOTS_PER_BLOCK; i++) {
+        std::string name = "s" + std::to_string(i);
+        CHECK(write_model(disk, name, files[name], pattern(TAIL_FRAGMENT_SIZE - i, i), 0));
+    }
+    CHECK(disk.get_super_block().free_blocks == used - 1);
+    // 删除其中几个，空出的片段由较大的尾部复用（不分配新块）
+    for (int i = 0; i < 4; i++) {
+        CHECK(disk.delete_file("s" + std::to_string(i)));
+        files.erase("s" + std::to_string(i));
+    }
+    CHECK(write_model(disk, "mid", files["mid"], pattern(3 * TAIL_FRAGMENT_SIZE, 20), 0));
+    CHECK(disk.get_super_block().free_blocks == used - 1);
+
+    // 增长：尾部 -> 数据块 + 尾部 -> 多块 + 私有尾部块，期间穿插覆盖写入
+    std::string& grow = files["grow"];
+    const size_t sizes[] = {1000, (size_t)TAIL_PACK_MAX, BLOCK_SIZE - 1, BLOCK_SIZE + 100, 3 * BLOCK_SIZE + TAIL_PACK_MAX + 1, 5 * BLOCK_SIZE + 700};
+    int seed = 30;
+    for (size_t size : sizes) {
+        CHECK(write_model(disk, "grow", grow, pattern(size - grow.size(), ++seed), grow.size()));
+        CHECK(write_model(disk, "grow", grow, pattern(300, ++seed), grow.size() / 2));
+        CHECK(read_all(disk, "grow") == grow);
+    }
+    for (const auto& file : files) CHECK(read_all(disk, file.first) == file.second);
+
+    CHECK(disk.unmount());
+    CHECK(disk.mount(options));
+    for (const auto& file : files) CHECK(read_all(disk, file.first) == file.second);
+
+    // 重新挂载后片段占用表按inode重建：新的小文件放入已有共享块的空闲片段，删除后全部回收
+    used = disk.get_super_block().free_blocks;
+    CHECK(write_model(disk, "new", files["new"], pattern(TAIL_FRAGMENT_SIZE, 40), 0));
+    CHECK(disk.get_super_block().free_blocks == used);
+    for (const auto& file : files) CHECK(disk.delete_file(file.first));
+    CHECK(disk.get_super_block().free_blocks == free_blocks);
+    CHECK(disk.unmount());
+}
+
+/**
+ * lazytime：只有修改时间变化的inode更新暂存在内存中，sync与卸载时写回磁盘；
+ * 重新挂载后内容与修改时间都已持久化
+ */
+static void test_lazytime_persistence()
+{
+    DiskFS disk(IMAGE);
+    MountOptions options;
+    options.lazytime = true;
+    CHECK(disk.format());
+    CHECK(disk.mount(options));
+    std::string model = pattern(3 * BLOCK_SIZE, 1);
+    CHECK(disk.create_dir("d") >= 0);
+    CHECK(disk.write_path("d/data", model.data(), model.size(), 0, OPEN_CREATE) == (int)model.size());
+    int inode_num = disk.open_file("d/data");
+    CHECK(inode_num >= 0);
+    CHECK(disk.unmount());
+    Inode before;
+    CHECK(read_raw_inode((uint32_t)inode_num, before));
+
+    // 卸载时写回：块内覆盖写入只改变修改时间
+    wait_past(before.modify_time);
+    CHECK(disk.mount(options));
+    CHECK(disk.write_path("d/data", "abc", 3, 100) == 3);
+    model_write(model, "abc", 100);
+    CHECK(disk.unmount());
+    Inode after;
+    CHECK(read_raw_inode((uint32_t)inode_num, after));
+    CHECK(after.modify_time > before.modify_time);
+    CHECK(after.size == before.size);
+
+    // sync时写回（不卸载）
+    wait_past(after.modify_time);
+    CHECK(disk.mount(options));
+    CHECK(disk.write_path("d/data", "xyz", 3, BLOCK_SIZE + 5) == 3);
+    model_write(model, "xyz", BLOCK_SIZE + 5);
+    CHECK(disk.sync());
+    Inode synced;
+    CHECK(read_raw_inode((uint32_t)inode_num, synced));
+    CHECK(synced.modify_time > after.modify_time);
+    CHECK(disk.unmount());
+
+    // 重新挂载（不使用lazytime）后内容不变
+    CHECK(disk.mount());
+    CHECK(read_all(disk, "d/data") == model);
+    CHECK(disk.unmount());
+}
+
+// 经游标读出目录中的全部文件名
+static std::vector<std::string> scan_dir(DiskFS& disk, const std::string& path)
+{
+    std::vector<std::string> names;
+    DirCursor cursor;
+    DirEntry entry;
+    if (!disk.open_dir(path, cursor)) return names;
+    while (disk.read_dir(cursor, entry)) names.push_back(entry.name);
+    return names;
+}
+
+static std::string entry_name(const char* prefix, int i)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%s%05d", prefix, i);
+    return name;
+}
+
+/**
+ * 线性目录增长到DIR_BTREE_MIN_BLOCKS块后转换为B+树目录：转换后查找、删除、再创建均正确，
+ * 目录遍历按文件名顺序返回；重新挂载后仍为B+树目录
+ */
+static void test_dir_conversion()
+{
+    DiskFS disk(IMAGE);
+    CHECK(disk.format());
+    CHECK(disk.mount());
+    CHECK(disk.create_dir("big") >= 0);
+
+    const int count = 3000;
+    std::set<std::string> model;
+    for (int i = 0; i < count; i++) {
+        std::string name = entry_name("file_", (i * 7919) % count);  // 打乱创建顺序
+        CHECK(disk.create_file("big/" + name) >= 0);
+        model.insert(name);
+    }
+    std::vector<std::string> names = scan_dir(disk, "big");
+    CHECK(names.size() == model.size());
+    CHECK(std::is_sorted(names.begin(), names.end()));  // B+树目录按文件名顺序遍历
+    CHECK(std::set<std::string>(names.begin(), names.end()) == model);
+
+    // 转换后的查找与删除
+    for (int i = 0; i < count; i += 3) {
+        std::string name = entry_name("file_", i);
+        CHECK(disk.delete_file("big/" + name));
+        model.erase(name);
+    }
+    for (int i = 0; i < count; i++) {
+        std::string name = entry_name("file_", i);
+        CHECK((disk.open_file("big/" + name) >= 0) == (model.count(name) > 0));
+    }
+    CHECK(!disk.delete_file("big/" + entry_name("file_", 0)));
+    CHECK(disk.create_file("big/" + entry_name("file_", 0)) >= 0);
+    model.insert(entry_name("file_", 0));
+    CHECK(disk.create_file("big/" + entry_name("file_", 1)) == -1);  // 已存在
+
+    CHECK(disk.unmount());
+    CHECK(disk.mount());
+    names = scan_dir(disk, "big");
+    CHECK(std::is_sorted(names.begin(), names.end()));
+    CHECK(std::set<std::string>(names.begin(), names.end()) == model);
+    for (const auto& name : model) CHECK(disk.open_file("big/" + name) >= 0);
+
+    // 删空后可以删除目录
+    for (const auto& name : model) CHECK(disk.delete_file("big/" + name));
+    CHECK(scan_dir(disk, "big").empty());
+    CHECK(disk.delete_dir("big"));
+    CHECK(disk.unmount());
+}
+
+// 经线程池执行一条命令并等待其结果
+static std::string run_command(ThreadPool& pool, CommandType type, const std::vector<std::string>& args)
+{
+    Task task;
+    task.type = type;
+    task.args = args;
+    task.completed = false;
+    return pool.add_task(task).get();
+}
+
+static bool starts_with(const std::string& text, const std::string& prefix)
+{
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+/**
+ * 经线程池执行MKDIR/RMDIR：多级目录的创建与删除，已存在、父目录不存在、目录非空等错误，
+ * 以及目录中文件的增删
+ */
+static void test_pool_dirs()
+{
+    DiskFS disk(IMAGE);
+    CHECK(disk.format());
+    CHECK(disk.mount());
+    {
+        ThreadPool pool(&disk, 2);
+        CHECK(starts_with(run_command(pool, CommandType::MKDIR, {"a"}), "目录创建成功"));
+        CHECK(starts_with(run_command(pool, CommandType::MKDIR, {"a/b"}), "目录创建成功"));
+        CHECK(starts_with(run_command(pool, CommandType::MKDIR, {"/a/b/c"}), "目录创建成功"));
+        CHECK(starts_with(run_command(pool, CommandType::MKDIR, {"a"}), "错误"));      // 已存在
+        CHECK(starts_with(run_command(pool, CommandType::MKDIR, {"x/y"}), "错误"));    // 父目录不存在
+        CHECK(starts_with(run_command(pool, CommandType::MKDIR, {}), "错误"));
+        CHECK(starts_with(run_command(pool, CommandType::WRITE, {"a/b/f", "data"}), "写入成功"));
+        CHECK(starts_with(run_command(pool, CommandType::MKDIR, {"a/b/f"}), "错误"));  // 与文件同名
+        CHECK(starts_with(run_command(pool, CommandType::RMDIR, {"a/b/f"}), "删除失败"));  // 不是目录
+        CHECK(starts_with(run_command(pool, CommandType::RMDIR, {"a"}), "删除失败"));  // 非空
+        CHECK(starts_with(run_command(pool, CommandType::RMDIR, {"a/b/c"}), "目录删除成功"));
+        CHECK(starts_with(run_command(pool, CommandType::RMDIR, {"a/b"}), "删除失败"));  // 仍有文件f
+        CHECK(starts_with(run_command(pool, CommandType::CAT, {"a/b/f"}), "文件内容:\ndata"));
+        CHECK(starts_with(run_command(pool, CommandType::RM, {"a/b/f"}), "删除成功"));
+        CHECK(starts_with(run_command(pool, CommandType::RMDIR, {"a/b"}), "目录删除成功"));
+        CHECK(starts_with(run_command(pool, CommandType::RMDIR, {"a/b"}), "删除失败"));  // 已删除
+        CHECK(starts_with(run_command(pool, CommandType::MKDIR, {"a/b"}), "目录创建成功"));  // 删除后可重建
+        pool.wait_for_completion();
+    }
+    CHECK(disk.unmount());
+    CHECK(disk.mount());
+    CHECK(scan_dir(disk, "a/b").empty());
+    CHECK(disk.open_file("a/b/f") == -1);
+    CHECK(disk.delete_dir("a/b"));
+    CHECK(disk.delete_dir("a"));
+    CHECK(disk.unmount());
+}
+
+/**
+ * 目录遍历期间目录被修改：已返回的文件名不会重复返回，遍历期间一直存在的文件名不会遗漏。
+ * B+树目录中在游标之前插入、之后删除会移动叶子中的记录并分裂叶子；
+ * 线性目录在遍历期间转换为B+树目录时，游标按上次返回的文件名在树中重新定位
+ */
+static void test_read_dir_changes()
+{
+    DiskFS disk(IMAGE);
+    CHECK(disk.format());
+    CHECK(disk.mount());
+
+    // B+树目录
+    CHECK(disk.create_dir("tree") >= 0);
+    std::set<std::string> stable;
+    for (int i = 0; i < 3000; i++) {
+        CHECK(disk.create_file("tree/" + entry_name("m", i)) >= 0);
+        if (i < 2000) stable.insert(entry_name("m", i));
+    }
+    DirCursor cursor;
+    DirEntry entry;
+    std::set<std::string> seen;
+    CHECK(disk.open_dir("tree", cursor));
+    for (int i = 0; i < 20 && disk.read_dir(cursor, entry); i++) CHECK(seen.insert(entry.name).second);
+    for (int i = 0; i < 300; i++) CHECK(disk.create_file("tree/" + entry_name("a", i)) >= 0);  // 排在游标之前
+    for (int i = 2000; i < 3000; i++) CHECK(disk.delete_file("tree/" + entry_name("m", i)));
+    for (int i = 0; i < 300; i++) CHECK(disk.create_file("tree/" + entry_name("z", i)) >= 0);
+    while (disk.read_dir(cursor, entry)) CHECK(seen.insert(entry.name).second);
+    for (const auto& name : stable) CHECK(seen.count(name) == 1);
+    for (int i = 0; i < 300; i++) CHECK(seen.count(entry_name("z", i)) == 1);  // 游标之后插入的文件名
+
+    // 线性目录在遍历期间转换为B+树目录
+    CHECK(disk.create_dir("grow") >= 0);
+    stable.clear();
+    for (int i = 0; i < 100; i++) {
+        CHECK(disk.create_file("grow/" + entry_name("f", i)) >= 0);
+        stable.insert(entry_name("f", i));
+    }
+    seen.clear();
+    CHECK(disk.open_dir("grow", cursor));
+    for (int i = 0; i < 50 && disk.read_dir(cursor, entry); i++) CHECK(seen.insert(entry.name).second);
+    for (int i = 100; i < 3000; i++) CHECK(disk.create_file("grow/" + entry_name("f", i)) >= 0);
+    while (disk.read_dir(cursor, entry)) CHECK(seen.insert(entry.name).second);
+    for (const auto& name : stable) CHECK(seen.count(name) == 1);
+
+    // 线性目录中删除上次返回的文件名后继续遍历
+    CHECK(disk.create_dir("small") >= 0);
+    for (int i = 0; i < 50; i++) CHECK(disk.create_file("small/" + entry_name("s", i)) >= 0);
+    seen.clear();
+    std::string last;
+    CHECK(disk.open_dir("small", cursor));
+    for (int i = 0; i < 10 && disk.read_dir(cursor, entry); i++) {
+        seen.insert(entry.name);
+        last = entry.name;
+    }
+    CHECK(disk.delete_file("small/" + last));
+    while (disk.read_dir(cursor, entry)) CHECK(seen.insert(entry.name).second);
+    CHECK(seen.size() == 50);
+    CHECK(disk.unmount());
+}
+
+static std::vector<std::string> entry_names(const std::vector<DirEntry>& entries)
+{
+    std::vector<std::string> names;
+    for (const auto& entry : entries) names.push_back(entry.name);
+    return names;
+}
+
+/**
+ * 按文件名顺序的范围与前缀列出：线性目录与B+树目录的结果均与有序集合的对应区间相同
+ */
+static void test_list_range()
+{
+    DiskFS disk(IMAGE);
+    CHECK(disk.format());
+    CHECK(disk.mount());
+    const char* dirs[] = {"linear", "tree"};
+    const int counts[] = {60, 2500};
+    for (int d = 0; d < 2; d++) {
+        std::string dir = dirs[d];
+        std::set<std::string> model;
+        CHECK(disk.create_dir(dir) >= 0);
+        for (int i = 0; i < counts[d]; i++) {
+            std::string name = entry_name(i % 3 == 0 ? "ab" : i % 3 == 1 ? "b" : "abc", (i * 37) % counts[d]);
+            if (model.insert(name).second) CHECK(disk.create_file(dir + "/" + name) >= 0);
+        }
+        CHECK(disk.create_dir(dir + "/b_sub") >= 0);  // 子目录同样列出
+        model.insert("b_sub");
+
+        auto range = [&model](const std::string& first, const std::string& last) {
+            std::vector<std::string> names;
+            for (auto it = model.lower_bound(first); it != model.end() && (last.empty() || *it < last); ++it) names.push_back(*it);
+            return names;
+        };
+        CHECK(entry_names(disk.list_range(dir, "", "")) == range("", ""));
+        CHECK(entry_names(disk.list_range(dir, "ab00010", "abc")) == range("ab00010", "abc"));
+        CHECK(entry_names(disk.list_range(dir, "abc", "")) == range("abc", ""));
+        CHECK(entry_names(disk.list_range(dir, "b", "b")).empty());
+        CHECK(entry_names(disk.list_range(dir, "z", "a")).empty());
+        CHECK(entry_names(disk.list_prefix(dir, "ab")) == range("ab", "ac"));
+        CHECK(entry_names(disk.list_prefix(dir, "abc0001")) == range("abc0001", "abc0002"));
+        CHECK(entry_names(disk.list_prefix(dir, "b_")) == std::vector<std::string>({"b_sub"}));
+        CHECK(disk.list_prefix(dir, "zz").empty());
+        CHECK(entry_names(disk.list_prefix(dir, "")) == range("", ""));
+    }
+    CHECK(disk.list_prefix("missing", "a").empty());
+    CHECK(disk.list_range("linear/ab00000", "", "").empty());  // 不是目录
+    CHECK(disk.unmount());
+}
+
+/**
+ * 多个线程按路径并发写入（创建）、读取与删除同一组文件：每次写入整个文件（3000个相同字符），
+ * 读取到的内容要么不存在，要么是某一次完整的写入（文件在查找与读写之间不会被删除或复用）
+ */
+static void test_concurrent_paths()
+{
+    DiskFS disk(IMAGE);
+    CHECK(disk.format());
+    CHECK(disk.mount());
+    CHECK(disk.create_dir("c") >= 0);
+    const uint32_t free_blocks = disk.get_super_block().free_blocks;
+    const size_t size = 3000;
+    std::atomic<int> bad(0), reads(0), writes(0);
+
+    auto worker = [&](int id) {
+        std::mt19937 gen(id);
+        for (int i = 0; i < 1500; i++) {
+            std::string name = "c/f" + std::to_string(gen() % 6);
+            std::string data(size, (char)('a' + gen() % 26));
+            std::string content;
+            switch (gen() % 4) {
+                case 0:
+                    if (disk.write_path(name, data.data(), size, 0, OPEN_CREATE) != (int)size) bad++;
+                    writes++;
+                    break;
+                case 1: {
+                    int n = disk.write_path(name, data.data(), size, 0, OPEN_CREATE | OPEN_EXCL);  // 已存在时失败
+                    if (n != -1 && n != (int)size) bad++;
+                    break;
+                }
+                case 2:
+                    disk.delete_file(name);
+                    break;
+                default: {
+                    int n = disk.read_path(name, content);
+                    if (n < 0) break;
+                    reads++;
+                    if (n != (int)size || content.size() != size || content.find_first_not_of(content[0]) != std::string::npos) bad++;
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) threads.emplace_back(worker, i);
+    for (auto& t : threads) t.join();
+    CHECK(bad == 0);
+    CHECK(reads > 0 && writes > 0);
+
+    CHECK(disk.unmount());
+    CHECK(disk.mount());
+    for (int i = 0; i < 6; i++) {
+        std::string content = read_all(disk, "c/f" + std::to_string(i));
+        CHECK(content == "<none>" || (content.size() == size && content.find_first_not_of(content[0]) == std::string::npos));
+        disk.delete_file("c/f" + std::to_string(i));
+    }
+    CHECK(disk.get_super_block().free_blocks == free_blocks);
+    CHECK(disk.unmount());
+}
+
+// 提交一个在工作线程中执行action的任务
+static std::future<std::string> add_action(ThreadPool& pool, std::function<void()> action)
+{
+    Task task;
+    task.type = CommandType::EMPTY;
+    task.completed = false;
+    task.action = std::move(action);
+    return pool.add_task(task);
+}
+
+/**
+ * 工作线程在执行任务期间提交大量任务，使所有工作线程的队列全部填满：提交者执行已排队的任务腾出空位，
+ * 全部任务恰好执行一次；同时外部线程也在提交任务（队列满时等待空位）
+ */
+static void test_pool_full_rings()
+{
+    DiskFS disk(IMAGE);
+    CHECK(disk.format());
+    CHECK(disk.mount());
+    const int workers = 2, producers = 3;
+    const int per_producer = (int)TASK_RING_CAPACITY * workers + 500;  // 超出全部队列的容量
+    std::vector<std::atomic<int>> runs(producers * per_producer + per_producer);
+    for (auto& r : runs) r = 0;
+    {
+        ThreadPool pool(&disk, workers);
+        std::vector<std::future<std::string>> fillers;
+        for (int p = 0; p < producers; p++) {
+            fillers.push_back(add_action(pool, [&pool, &runs, p, per_producer] {
+                for (int i = 0; i < per_producer; i++) {
+                    int id = p * per_producer + i;
+                    add_action(pool, [&runs, id] { runs[id]++; });
+                }
+            }));
+        }
+        // 外部线程同时提交
+        for (int i = 0; i < per_producer; i++) {
+            int id = producers * per_producer + i;
+            add_action(pool, [&runs, id] { runs[id]++; });
+        }
+        for (auto& filler : fillers) filler.wait();
+        pool.wait_for_completion();
+        CHECK(pool.get_active_tasks() == 0);
+    }
+    int wrong = 0;
+    for (auto& r : runs) wrong += r != 1;
+    CHECK(wrong == 0);
+    CHECK(disk.unmount());
+}
+
+static Task make_task(CommandType type, const std::vector<std::string>& args)
+{
+    Task task;
+    task.type = type;
+    task.args = args;
+    task.completed = false;
+    return task;
+}
+
+/**
+ * @brief 在新格式化的磁盘上执行一组任务，返回各任务的结果
+ * @param batched 为true时先用一个阻塞的任务占住唯一的工作线程，使其余任务排队后被成批取出、
+ *                相邻的同目录WRITE/TOUCH合并执行；为false时逐个提交并等待（每批只有一个任务）
+ */
+static std::vector<std::string> run_tasks(DiskFS& disk, const std::vector<Task>& tasks, bool batched)
+{
+    std::vector<std::string> results;
+    ThreadPool pool(&disk, 1);
+    if (!batched) {
+        for (const Task& task : tasks) results.push_back(pool.add_task(task).get());
+        return results;
+    }
+    std::promise<void> release;
+    std::shared_future<void> gate = release.get_future().share();
+    add_action(pool, [gate] { gate.wait(); });
+    std::vector<std::future<std::string>> futures;
+    for (const Task& task : tasks) futures.push_back(pool.add_task(task));
+    release.set_value();
+    for (auto& future : futures) results.push_back(future.get());
+    return results;
+}
+
+/**
+ * 合并执行的WRITE/TOUCH与逐个执行的结果相同：目录不存在、目标是目录、同一组内重复的文件名、
+ * 文件名过长，以及执行后的文件内容
+ */
+static void test_batched_writes()
+{
+    const std::string long_name(MAX_FILENAME + 10, 'n');
+    const std::vector<Task> tasks = {
+        make_task(CommandType::TOUCH, {"d/x"}),
+        make_task(CommandType::WRITE, {"d/x", "hello", "world"}),
+        make_task(CommandType::WRITE, {"d/sub", "a"}),          // 目标是目录
+        make_task(CommandType::TOUCH, {"d/sub"}),
+        make_task(CommandType::TOUCH, {"d/" + long_name}),      // 文件名过长
+        make_task(CommandType::WRITE, {"d/" + long_name, "z"}),
+        make_task(CommandType::WRITE, {"d/y", "\"quoted\""}),
+        make_task(CommandType::WRITE, {"d/x", "hi"}),           // 同一组内重复的文件名
+        make_task(CommandType::WRITE, {"nodir/a", "1"}),        // 目录不存在
+        make_task(CommandType::TOUCH, {"nodir/b"}),
+        make_task(CommandType::TOUCH, {"r"}),
+        make_task(CommandType::WRITE, {"r", "abc"}),
+        make_task(CommandType::TOUCH, {"r"}),
+        make_task(CommandType::WRITE, {"d/sub/deep", "x"}),
+        make_task(CommandType::TOUCH, {"d/sub/deep2"}),
+        make_task(CommandType::CAT, {"d/x"}),
+    };
+
+    std::vector<std::string> results[2];
+    std::map<std::string, std::string> contents[2];
+    for (int batched = 0; batched < 2; batched++) {
+        DiskFS disk(IMAGE);
+        CHECK(disk.format());
+        CHECK(disk.mount());
+        CHECK(disk.create_dir("d") >= 0);
+        CHECK(disk.create_dir("d/sub") >= 0);
+        results[batched] = run_tasks(disk, tasks, batched != 0);
+        for (const char* path : {"d/x", "d/y", "r", "d/sub/deep", "d/sub/deep2", "nodir/a"}) {
+            contents[batched][path] = read_all(disk, path);
+        }
+        CHECK(entry_names(disk.list_range("d", "", "")) == std::vector<std::string>({"sub", "x", "y"}));
+        CHECK(disk.unmount());
+    }
+    CHECK(results[0].size() == tasks.size() && results[1].size() == tasks.size());
+    for (size_t i = 0; i < tasks.size() && i < results[0].size() && i < results[1].size(); i++) {
+        if (results[0][i] != results[1][i]) report << "  任务" << i << "：" << results[0][i] << " / " << results[1][i];
+        CHECK(results[0][i] == results[1][i]);
+    }
+    CHECK(contents[0] == contents[1]);
+    CHECK(contents[1]["d/x"] == "hillo world");  // 写入不截断文件
+    CHECK(contents[1]["d/y"] == "quoted");
+    CHECK(contents[1]["r"] == "abc");
+    CHECK(contents[1]["nodir/a"] == "<none>");
+}
+
+int main()
+{
+    // 屏蔽文件系统自身输出的提示信息，只输出测试结果
+    std::stringstream discard;
+    std::streambuf* cout_buf = std::cout.rdbuf(discard.rdbuf());
+    std::streambuf* cerr_buf = std::cerr.rdbuf(discard.rdbuf());
+
+    struct Case {
+        const char* name;
+        void (*run)();
+    };
+    const Case cases[] = {
+        {"SIMFSv1镜像升级", test_v1_upgrade},
+        {"大文件块映射（直接/间接块）", [] { test_block_maps(false); }},
+        {"大文件块映射（extent树）", [] { test_block_maps(true); }},
+        {"内联小文件", test_inline_data},
+        {"尾部打包（直接/间接块）", [] { test_tail_packing(false); }},
+        {"尾部打包（extent树）", [] { test_tail_packing(true); }},
+        {"lazytime与重新挂载", test_lazytime_persistence},
+        {"线性目录转换为B+树目录", test_dir_conversion},
+        {"线程池中的MKDIR/RMDIR", test_pool_dirs},
+        {"目录遍历期间修改目录", test_read_dir_changes},
+        {"按范围与前缀列出", test_list_range},
+        {"按路径并发读写与删除", test_concurrent_paths},
+        {"工作线程填满任务队列", test_pool_full_rings},
+        {"合并执行的WRITE/TOUCH", test_batched_writes},
+    };
+    for (const Case& c : cases) {
+        int before = failures;
+        c.run();
+        discard.str("");
+        report << (failures == before ? "[通过] " : "[失败] ") << c.name << std::endl;
+    }
+    std::remove(IMAGE.c_str());
+
+    std::cout.rdbuf(cout_buf);
+    std::cerr.rdbuf(cerr_buf);
+    report << (failures == 0 ? "全部回归测试通过" : "回归测试失败，失败的检查数：" + std::to_string(failures)) << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -94,7 +94,7 @@ void stress_test()
     for (size_t i = 0; i < INIT_FILE_COUNT; ++i) {
         std::string name = "test_" + random_string(8) + ".txt";
         filenames.push_back(name);
-        Task task{CommandType::TOUCH, {name}, "", false, std::chrono::steady_clock::now()};
+        Task task{CommandType::TOUCH, {name}, "", false, std::chrono::steady_clock::now(), nullptr};
         pool.add_task(task);
     }
     pool.wait_for_completion(); // 等待文件创建完成
@@ -114,18 +114,18 @@ void stress_test()
 
         switch (op_dist(gen)) {
             case 0: // LS命令
-                task = {CommandType::LS, {}, "", false, std::chrono::steady_clock::now()};
+                task = {CommandType::LS, {}, "", false, std::chrono::steady_clock::now(), nullptr};
                 break;
             
             case 1: // CAT命令
-                task = {CommandType::CAT, {filenames[file_dist(gen)]}, "", false, std::chrono::steady_clock::now()};
+                task = {CommandType::CAT, {filenames[file_dist(gen)]}, "", false, std::chrono::steady_clock::now(), nullptr};
                 break;
             
             case 2: // WRITE命令
             {
                 // 生成1KB随机内容，并在首尾添加双引号
                 std::string content = "\"" + random_string(1024) + "\"";
-                task = {CommandType::WRITE, {filenames[file_dist(gen)], content}, "", false, std::chrono::steady_clock::now()};
+                task = {CommandType::WRITE, {filenames[file_dist(gen)], content}, "", false, std::chrono::steady_clock::now(), nullptr};
                 break;
             }
             
@@ -133,11 +133,10 @@ void stress_test()
             {
                 std::string name = filenames[file_dist(gen)];
                 // 先删除
-                Task rm_task{CommandType::RM, {name}, "", false, std::chrono::steady_clock::now()};
-                pool.add_task(rm_task);
-                pool.wait_for_completion();
+                Task rm_task{CommandType::RM, {name}, "", false, std::chrono::steady_clock::now(), nullptr};
+                pool.add_task(rm_task).wait();  // 只等待删除完成，不等待其他任务
                 // 再重建
-                Task touch_task{CommandType::TOUCH, {name}, "", false, std::chrono::steady_clock::now()};
+                Task touch_task{CommandType::TOUCH, {name}, "", false, std::chrono::steady_clock::now(), nullptr};
                 pool.add_task(touch_task);
                 break;
             }
@@ -146,7 +145,7 @@ void stress_test()
             {
                 std::string src = filenames[file_dist(gen)];
                 std::string dest = "copy_" + random_string(8) + ".txt";
-                task = {CommandType::COPY, {src, dest}, "", false, std::chrono::steady_clock::now()};
+                task = {CommandType::COPY, {src, dest}, "", false, std::chrono::steady_clock::now(), nullptr};
                 break;
             }
         }
@@ -0,0 +1,127 @@
+#include "../include/task_queue.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// 基准测试配置参数
+const size_t ITEMS = 1 << 18;                        // 每组测试传递的元素总数
+const size_t THREAD_COUNTS[] = {1, 2, 4, 8, 16, 32, 64};  // 线程总数（一半生产者、一半消费者）
+
+// 原有实现：std::queue + 互斥锁 + 条件变量（入队与出队争用同一个锁）
+class LockedQueue {
+public:
+    void push(uint64_t item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push(item);
+        cv.notify_one();
+    }
+
+    size_t pop(uint64_t* items, size_t) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return !queue.empty(); });
+        items[0] = queue.front();
+        queue.pop();
+        return 1;
+    }
+
+private:
+    std::queue<uint64_t> queue;
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+// 无锁环形队列：满或空时让出CPU后重试；Batch为true时一次出队至多TASK_BATCH_SIZE个元素
+template <bool Batch>
+class RingQueue {
+public:
+    RingQueue() : ring(TASK_RING_CAPACITY) {}
+
+    void push(uint64_t item) {
+        while (!ring.try_push(item)) std::this_thread::yield();
+    }
+
+    size_t pop(uint64_t* items, size_t max) {
+        while (true) {
+            size_t count = Batch ? ring.try_pop_batch(items, std::min(max, TASK_BATCH_SIZE)) : ring.try_pop(items[0]);
+            if (count > 0) return count;
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    MpmcRing<uint64_t> ring;
+};
+
+/**
+ * @brief 测量threads个线程经队列传递ITEMS个元素的吞吐量
+ * @return 每秒传递的元素数（百万），一次入队加一次出队计为一个元素
+ * 单线程时同一线程交替入队与出队；否则一半线程入队、一半线程出队，各自处理等量的元素
+ */
+template <typename Queue>
+double throughput(size_t threads)
+{
+    Queue queue;
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    uint64_t items[TASK_BATCH_SIZE];
+    if (threads == 1) {
+        for (size_t i = 0; i < ITEMS; i++) {
+            queue.push(i);
+            queue.pop(items, 1);
+            sum += items[0];
+        }
+    } else {
+        size_t producers = threads / 2, consumers = threads - producers;
+        std::vector<uint64_t> sums(consumers, 0);
+        std::vector<std::thread> pool;
+        for (size_t p = 0; p < producers; p++) {
+            pool.emplace_back([&queue, p, producers] {
+                for (size_t i = p; i < ITEMS; i += producers) queue.push(i);
+            });
+        }
+        for (size_t c = 0; c < consumers; c++) {
+            pool.emplace_back([&queue, &sums, c, consumers] {
+                // 每个消费者恰好取出自己的份额，批量出队时不多取，避免其他消费者等不到元素
+                uint64_t buffer[TASK_BATCH_SIZE];
+                for (size_t left = (ITEMS - c + consumers - 1) / consumers; left > 0; ) {
+                    size_t count = queue.pop(buffer, std::min(left, TASK_BATCH_SIZE));
+                    for (size_t i = 0; i < count; i++) sums[c] += buffer[i];
+                    left -= count;
+                }
+            });
+        }
+        for (auto& t : pool) t.join();
+        for (uint64_t s : sums) sum += s;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    if (sum != (uint64_t)ITEMS * (ITEMS - 1) / 2) {
+        std::cerr << "错误：" << threads << "线程时出队元素之和不正确" << std::endl;
+    }
+    return ITEMS / std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+int main()
+{
+    std::cout << "任务队列基准测试（入队+出队吞吐量，百万项/秒；环形队列容量" << TASK_RING_CAPACITY
+              << "，本机" << std::thread::hardware_concurrency() << "个CPU核心）" << std::endl;
+    std::cout << std::setw(8) << "线程数" << std::setw(20) << "互斥锁+条件变量" << std::setw(16) << "MpmcRing"
+              << std::setw(24) << "MpmcRing批量出队" << std::endl;
+
+    for (size_t threads : THREAD_COUNTS) {
+        throughput<RingQueue<false>>(threads);  // 预热
+        double locked = throughput<LockedQueue>(threads);
+        double ring = throughput<RingQueue<false>>(threads);
+        double batched = throughput<RingQueue<true>>(threads);
+        std::cout << std::fixed << std::setprecision(2) << std::setw(8) << threads
+                  << std::setw(20) << locked << std::setw(16) << ring << std::setw(20) << batched << std::endl;
+    }
+    return 0;
+}